@@ -0,0 +1,109 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/Logger.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+建立连接的速率测试
+    single   : baseLoop上一个Acceptor accept之后分发给subloop
+    reuseport: TcpServer::kReusePortPerLoop 每个subloop自己accept
+客户端线程不停地 connect + close， close之前设置SO_LINGER为0 直接发送RST 避免客户端端口耗尽在TIME_WAIT上
+
+用法: ./accept_bench [single|reuseport] [ioThreads] [clientThreads] [seconds]
+*/
+
+static std::atomic<long> g_accepted(0);
+
+void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        ++g_accepted;
+    }
+}
+
+void clientThread(uint16_t port, int seconds, long *connects)
+{
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    long count = 0;
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0)
+        {
+            ++count;
+        }
+        struct linger lg = {1, 0};
+        ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof lg);
+        ::close(fd);
+    }
+    *connects = count;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string mode = argc > 1 ? argv[1] : "reuseport";
+    int ioThreads = argc > 2 ? atoi(argv[2]) : 4;
+    int clientThreads = argc > 3 ? atoi(argv[3]) : 4;
+    int seconds = argc > 4 ? atoi(argv[4]) : 3;
+    uint16_t port = 9981;
+
+    // 客户端发送RST 服务端会打印大量handleError日志
+    Logger::setLogLevel(FATAL);
+
+    EventLoop loop;
+    InetAddress listenAddr(port);
+    TcpServer server(&loop, listenAddr, "AcceptBench",
+                     mode == "single" ? TcpServer::kNoReusePort : TcpServer::kReusePortPerLoop);
+    server.setConnectionCallback(onConnection);
+    server.setThreadNum(ioThreads);
+    server.start();
+
+    std::vector<long> connects(clientThreads, 0);
+    std::thread driver([&]() {
+        std::vector<std::thread> clients;
+        for (int i = 0; i < clientThreads; ++i)
+        {
+            clients.emplace_back(clientThread, port, seconds, &connects[i]);
+        }
+        for (std::thread &t : clients)
+        {
+            t.join();
+        }
+        // 等待已经完成握手的连接被accept
+        ::usleep(200 * 1000);
+        loop.quit();
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    loop.loop();
+    driver.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long total = 0;
+    for (long n : connects)
+    {
+        total += n;
+    }
+    printf("mode=%s ioThreads=%d clientThreads=%d\n", mode.c_str(), ioThreads, clientThreads);
+    printf("connects=%ld accepted=%ld  %.0f conns/s\n", total, g_accepted.load(), g_accepted.load() / elapsed);
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <mymuduo/Clock.h>
+#include <mymuduo/Timestamp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <chrono>
+
+/*
+各个时钟源读取一次时间的开销
+    gettimeofday / clock_gettime(CLOCK_REALTIME)   原来 Timestamp::now() 的实现
+    CLOCK_MONOTONIC_COARSE                          Clock::kMonotonicCoarse
+    rdtsc                                           Clock::kTsc
+    Clock::cachedNow()                              EventLoop线程内本轮poll返回的时间
+
+用法: ./clock_bench [iterations]
+*/
+
+template <typename Func>
+double nsPerOp(long iterations, Func func)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i)
+    {
+        func();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 10000000;
+    volatile int64_t sink = 0;
+
+    double gettimeofdayNs = nsPerOp(iterations, [&]() {
+        struct timeval tv;
+        ::gettimeofday(&tv, NULL);
+        sink = tv.tv_usec;
+    });
+    double realtimeNs = nsPerOp(iterations, [&]() {
+        struct timespec ts;
+        ::clock_gettime(CLOCK_REALTIME, &ts);
+        sink = ts.tv_nsec;
+    });
+    double coarseRawNs = nsPerOp(iterations, [&]() {
+        struct timespec ts;
+        ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        sink = ts.tv_nsec;
+    });
+
+    printf("iterations=%ld\n", iterations);
+    printf("gettimeofday                 : %6.1f ns\n", gettimeofdayNs);
+    printf("clock_gettime(REALTIME)      : %6.1f ns\n", realtimeNs);
+    printf("clock_gettime(MONO_COARSE)   : %6.1f ns\n", coarseRawNs);
+
+    Clock::Source sources[] = {Clock::kRealtime, Clock::kMonotonicCoarse, Clock::kTsc};
+    for (Clock::Source source : sources)
+    {
+        Clock::Source actual = Clock::setSource(source);
+        if (actual != source)
+        {
+            printf("Timestamp::now() %-16s: unavailable\n", Clock::sourceName(source));
+            continue;
+        }
+        double ns = nsPerOp(iterations, [&]() {
+            sink = Timestamp::now().microSecondsSinceEpoch();
+        });
+        // 和gettimeofday比较 检查转换之后的时间是否准确
+        int64_t skew = Timestamp::now().microSecondsSinceEpoch() - Clock::realtimeMicroSeconds();
+        printf("Timestamp::now() %-16s: %6.1f ns  (skew vs gettimeofday %lld us)\n",
+                Clock::sourceName(source), ns, static_cast<long long>(skew));
+    }
+
+    Clock::setCachedNow(Clock::realtimeMicroSeconds());
+    double cachedNs = nsPerOp(iterations, [&]() {
+        sink = Clock::cachedNow();
+    });
+    printf("Clock::cachedNow()           : %6.1f ns\n", cachedNs);
+    (void)sink;
+    return 0;
+}
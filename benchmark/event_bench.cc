@@ -0,0 +1,141 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/Logger.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+/*
+单个subloop每秒能处理的读事件数
+客户端线程在conns个连接上各写一条16字节的消息， 再依次读回echo， 循环rounds轮
+服务端每条消息是一次可读事件 + 一次messageCallback + 一次send
+另外在第一个连接上比较在loop内拷贝TcpConnectionPtr(原子计数)和TcpConnectionHandle(普通int)的开销
+
+用法: ./event_bench [conns] [rounds]
+*/
+
+static std::atomic<long> g_messages(0);
+static double g_ptrCopyNs = 0;
+static double g_handleCopyNs = 0;
+
+const int kCopies = 10 * 1000 * 1000;
+
+template <typename T>
+double copyNs(const T &ref)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kCopies; ++i)
+    {
+        T copy(ref);
+        asm volatile("" : : "r"(&copy) : "memory");
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kCopies;
+}
+
+void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected() && g_ptrCopyNs == 0)
+    {
+        g_ptrCopyNs = copyNs(conn);
+        g_handleCopyNs = copyNs(conn->handle());
+    }
+}
+
+void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    g_messages.fetch_add(1, std::memory_order_relaxed);
+    conn->send(buf->retrieveAllAsString());
+}
+
+int connectTo(uint16_t port)
+{
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    return fd;
+}
+
+int main(int argc, char *argv[])
+{
+    int numConns = argc > 1 ? atoi(argv[1]) : 100;
+    int rounds = argc > 2 ? atoi(argv[2]) : 2000;
+    uint16_t port = 9983;
+    Logger::setLogLevel(ERROR);
+
+    EventLoop loop;
+    InetAddress listenAddr(port);
+    TcpServer server(&loop, listenAddr, "EventBench");
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.setThreadNum(1);
+    server.start();
+
+    double seconds = 0;
+    std::thread client([&]() {
+        std::vector<int> fds;
+        for (int i = 0; i < numConns; ++i)
+        {
+            fds.push_back(connectTo(port));
+        }
+        char msg[16];
+        ::memset(msg, 'x', sizeof msg);
+        char reply[16];
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r)
+        {
+            for (int fd : fds)
+            {
+                ::write(fd, msg, sizeof msg);
+            }
+            for (int fd : fds)
+            {
+                size_t got = 0;
+                while (got < sizeof reply)
+                {
+                    ssize_t n = ::read(fd, reply + got, sizeof reply - got);
+                    if (n <= 0)
+                    {
+                        perror("read");
+                        exit(1);
+                    }
+                    got += n;
+                }
+            }
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (int fd : fds)
+        {
+            ::close(fd);
+        }
+        ::usleep(100 * 1000);
+        loop.quit();
+    });
+    loop.loop();
+    client.join();
+
+    long messages = g_messages.load();
+    printf("conns=%d rounds=%d messages=%ld\n", numConns, rounds, messages);
+    printf("%.3f s  %.0f events/s on one io loop\n", seconds, messages / seconds);
+    printf("copy TcpConnectionPtr: %.2f ns  TcpConnectionHandle: %.2f ns\n", g_ptrCopyNs, g_handleCopyNs);
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <mymuduo/Logger.h>
+#include <mymuduo/AsyncLogging.h>
+#include <mymuduo/BinaryLogging.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+多线程写日志的吞吐量测试
+    sync  : 每条日志直接加锁fwrite + fflush 写文件 (和原来 std::cout << std::endl 的行为一致)
+    async : 前端写入AsyncLogging的buffer， 后台线程批量写入滚动日志文件
+    binary: BLOG_INFO 只记录格式串ID和原始参数到线程自己的环形缓冲区
+
+用法: ./logging_bench [threads] [messagesPerThread]
+*/
+
+static FILE *g_syncFile = nullptr;
+static std::mutex g_syncMutex;
+static AsyncLogging *g_asyncLog = nullptr;
+
+void syncOutput(const char *msg, int len)
+{
+    std::lock_guard<std::mutex> lock(g_syncMutex);
+    ::fwrite(msg, 1, len, g_syncFile);
+    ::fflush(g_syncFile);
+}
+
+void asyncOutput(const char *msg, int len)
+{
+    g_asyncLog->append(msg, len);
+}
+
+template <typename LogFunc>
+double runBench(int numThreads, int messagesPerThread, LogFunc logFunc)
+{
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i)
+    {
+        threads.emplace_back([i, messagesPerThread, logFunc]() {
+            for (int j = 0; j < messagesPerThread; ++j)
+            {
+                logFunc(i, j);
+            }
+        });
+    }
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+void textLog(int i, int j)
+{
+    LOG_INFO("thread %d message %d fd total count: %d\n", i, j, 1024);
+}
+
+void binaryLog(int i, int j)
+{
+    BLOG_INFO("thread %d message %d fd total count: %d\n", i, j, 1024);
+}
+
+int main(int argc, char *argv[])
+{
+    int numThreads = argc > 1 ? atoi(argv[1]) : 4;
+    int messagesPerThread = argc > 2 ? atoi(argv[2]) : 200000;
+    long total = static_cast<long>(numThreads) * messagesPerThread;
+
+    char syncName[64];
+    snprintf(syncName, sizeof syncName, "/tmp/logging_bench_sync.%d.log", ::getpid());
+    g_syncFile = ::fopen(syncName, "w");
+    Logger::setOutput(syncOutput);
+    double syncSeconds = runBench(numThreads, messagesPerThread, textLog);
+    ::fclose(g_syncFile);
+    ::unlink(syncName);
+
+    AsyncLogging asyncLog("/tmp/logging_bench_async", 500 * 1000 * 1000);
+    g_asyncLog = &asyncLog;
+    asyncLog.start();
+    Logger::setOutput(asyncOutput);
+    double asyncSeconds = runBench(numThreads, messagesPerThread, textLog);
+    asyncLog.stop();
+
+    char binaryName[64];
+    snprintf(binaryName, sizeof binaryName, "/tmp/logging_bench_binary.%d.blog", ::getpid());
+    // 每个线程16MB的环形缓冲区 压测时后台线程来不及写入的记录会被丢弃并统计
+    BinaryLogging::instance().start(binaryName, 16 * 1024 * 1024);
+    double binarySeconds = runBench(numThreads, messagesPerThread, binaryLog);
+    BinaryLogging::instance().stop();
+
+    printf("threads=%d messages=%ld\n", numThreads, total);
+    printf("sync  : %.3f s  %.0f msgs/s\n", syncSeconds, total / syncSeconds);
+    printf("async : %.3f s  %.0f msgs/s\n", asyncSeconds, total / asyncSeconds);
+    printf("binary: %.3f s  %.0f msgs/s  (decode with tools/blogdecode %s)\n",
+            binarySeconds, total / binarySeconds, binaryName);
+    return 0;
+}
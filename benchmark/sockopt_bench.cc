@@ -0,0 +1,174 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/Logger.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+SocketOptions 各个profile在loopback上的表现
+    latency : 客户端发送128字节请求 服务端回复4K字节响应 一问一答 统计延迟的p50/p99
+    download: 服务端不停地发送数据 客户端接收 统计吞吐
+客户端socket不设置任何选项 只有服务端的profile不同
+
+用法: ./sockopt_bench [default|lowlatency|bulk] [requests] [downloadMB]
+*/
+
+const size_t kRequestSize = 128;
+const size_t kResponseSize = 4096;
+const size_t kChunkSize = 64 * 1024;
+
+static size_t g_downloadBytes = 0;
+
+int connectTo(uint16_t port)
+{
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+void readFully(int fd, char *buf, size_t len)
+{
+    size_t got = 0;
+    while (got < len)
+    {
+        ssize_t n = ::read(fd, buf + got, len - got);
+        if (n <= 0)
+        {
+            perror("read");
+            exit(1);
+        }
+        got += n;
+    }
+}
+
+// 下载连接: 每次发送缓冲区写完之后再发送一块 直到发送g_downloadBytes
+void sendChunk(const TcpConnectionPtr &conn, size_t *remaining)
+{
+    static const std::string chunk(kChunkSize, 'd');
+    if (*remaining == 0)
+    {
+        return;
+    }
+    size_t n = std::min(*remaining, kChunkSize);
+    *remaining -= n;
+    conn->send(n == kChunkSize ? chunk : chunk.substr(0, n));
+}
+
+int main(int argc, char *argv[])
+{
+    std::string profile = argc > 1 ? argv[1] : "default";
+    int requests = argc > 2 ? atoi(argv[2]) : 20000;
+    int downloadMB = argc > 3 ? atoi(argv[3]) : 1024;
+    uint16_t port = 9985;
+    g_downloadBytes = static_cast<size_t>(downloadMB) * 1024 * 1024;
+    Logger::setLogLevel(ERROR);
+
+    SocketOptions options = SocketOptions::defaults();
+    if (profile == "lowlatency")
+    {
+        options = SocketOptions::lowLatency();
+    }
+    else if (profile == "bulk")
+    {
+        options = SocketOptions::bulk();
+    }
+
+    EventLoop loop;
+    InetAddress listenAddr(port);
+    TcpServer server(&loop, listenAddr, "SockoptBench");
+    server.setSocketOptions(options);
+    server.setThreadNum(1);
+    // 只有一个io线程 剩余字节数不需要加锁
+    size_t remaining = 0;
+    server.setConnectionCallback([](const TcpConnectionPtr &) {});
+    server.setWriteCompleteCallback([&remaining](const TcpConnectionPtr &conn) {
+        sendChunk(conn, &remaining);
+    });
+    const std::string response(kResponseSize, 'r');
+    server.setMessageCallback([&](const TcpConnectionPtr &conn, Buffer *buf, Timestamp) {
+        while (buf->readableBytes() > 0)
+        {
+            if (buf->peek()[0] == 'D')
+            {
+                buf->retrieve(1);
+                remaining = g_downloadBytes;
+                sendChunk(conn, &remaining);
+            }
+            else if (buf->readableBytes() >= kRequestSize)
+            {
+                buf->retrieve(kRequestSize);
+                conn->send(response);
+            }
+            else
+            {
+                break;
+            }
+        }
+    });
+    server.start();
+
+    std::vector<double> latencies;
+    double downloadSeconds = 0;
+    std::thread client([&]() {
+        int fd = connectTo(port);
+        std::string request(kRequestSize, 'q');
+        std::vector<char> reply(kResponseSize);
+        for (int i = 0; i < requests; ++i)
+        {
+            auto start = std::chrono::steady_clock::now();
+            ::write(fd, request.data(), request.size());
+            readFully(fd, reply.data(), reply.size());
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        }
+        ::close(fd);
+
+        fd = connectTo(port);
+        std::vector<char> buf(kChunkSize);
+        auto start = std::chrono::steady_clock::now();
+        ::write(fd, "D", 1);
+        size_t received = 0;
+        while (received < g_downloadBytes)
+        {
+            ssize_t n = ::read(fd, buf.data(), buf.size());
+            if (n <= 0)
+            {
+                perror("read");
+                exit(1);
+            }
+            received += n;
+        }
+        downloadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ::close(fd);
+        ::usleep(100 * 1000);
+        loop.quit();
+    });
+    loop.loop();
+    client.join();
+
+    std::sort(latencies.begin(), latencies.end());
+    printf("profile=%s\n", profile.c_str());
+    printf("latency : %d requests p50=%.1f us p99=%.1f us\n", requests,
+           latencies[latencies.size() / 2], latencies[latencies.size() * 99 / 100]);
+    printf("download: %d MB in %.3f s  %.0f MB/s\n", downloadMB, downloadSeconds, downloadMB / downloadSeconds);
+    return 0;
+}
@@ -0,0 +1,78 @@
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/EventLoopThread.h>
+#include <mymuduo/EventLoopThreadPool.h>
+#include <mymuduo/Logger.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+/*
+loop线程的启动时间
+    serial  : 逐个调用EventLoopThread::startLoop 每个线程创建好EventLoop之后才启动下一个
+    parallel: EventLoopThreadPool::start 所有线程同时启动 等待一次
+    prewarm : parallel 并且每个loop预先分配prewarmChannels个channel的空间
+
+用法: ./startup_bench [threads] [prewarmChannels]
+*/
+
+// loop线程初始化时模拟一些准备工作 (加载配置、建立本线程的缓存等)
+void threadInit(EventLoop*)
+{
+    std::vector<char> scratch(4 * 1024 * 1024, 1);
+    volatile char sink = scratch[scratch.size() - 1];
+    (void)sink;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    int numThreads = argc > 1 ? atoi(argv[1]) : 64;
+    int prewarmChannels = argc > 2 ? atoi(argv[2]) : 10000;
+    Logger::setLogLevel(ERROR);
+
+    EventLoop baseLoop;
+
+    double serialMs = 0;
+    {
+        std::vector<std::unique_ptr<EventLoopThread>> threads;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < numThreads; ++i)
+        {
+            threads.emplace_back(new EventLoopThread(threadInit));
+            threads.back()->startLoop();
+        }
+        serialMs = elapsedMs(start);
+    }
+
+    double parallelMs = 0;
+    {
+        EventLoopThreadPool pool(&baseLoop, "parallel");
+        pool.setThreadNum(numThreads);
+        auto start = std::chrono::steady_clock::now();
+        pool.start(threadInit);
+        parallelMs = elapsedMs(start);
+    }
+
+    double prewarmMs = 0;
+    {
+        EventLoopThreadPool pool(&baseLoop, "prewarm");
+        pool.setThreadNum(numThreads);
+        pool.setPrewarm(prewarmChannels);
+        auto start = std::chrono::steady_clock::now();
+        pool.start(threadInit);
+        prewarmMs = elapsedMs(start);
+    }
+
+    printf("threads=%d\n", numThreads);
+    printf("serial  : %.2f ms\n", serialMs);
+    printf("parallel: %.2f ms\n", parallelMs);
+    printf("prewarm : %.2f ms  (%d channels per loop)\n", prewarmMs, prewarmChannels);
+    return 0;
+}
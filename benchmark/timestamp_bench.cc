@@ -0,0 +1,56 @@
+#include <mymuduo/Logger.h>
+#include <mymuduo/Timestamp.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+/*
+日志时间前缀的格式化开销
+    toString   : 每行都调用 Timestamp::now().toString()  (localtime + snprintf + std::string)
+    cached     : Logger::formatTime(Timestamp::now())    线程内缓存 同一秒只追加微秒
+    precomputed: Logger::formatTime(pollReturnTime)      使用已有的时间戳 不读取时钟
+
+用法: ./timestamp_bench [iterations]
+*/
+
+template <typename Func>
+double nsPerOp(long iterations, Func func)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < iterations; ++i)
+    {
+        func();
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / iterations;
+}
+
+int main(int argc, char *argv[])
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 5000000;
+    char buf[64];
+    size_t sink = 0;
+
+    double toStringNs = nsPerOp(iterations, [&]() {
+        std::string s = Timestamp::now().toString();
+        sink += s.size();
+    });
+
+    double cachedNs = nsPerOp(iterations, [&]() {
+        sink += Logger::formatTime(Timestamp::now(), buf);
+    });
+
+    Timestamp pollReturnTime = Timestamp::now();
+    double precomputedNs = nsPerOp(iterations, [&]() {
+        sink += Logger::formatTime(pollReturnTime, buf);
+    });
+
+    printf("iterations=%ld (sink=%zu)\n", iterations, sink);
+    printf("toString    : %.1f ns/line\n", toStringNs);
+    printf("cached      : %.1f ns/line\n", cachedNs);
+    printf("precomputed : %.1f ns/line\n", precomputedNs);
+    return 0;
+}
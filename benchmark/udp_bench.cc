@@ -0,0 +1,187 @@
+#include <mymuduo/UdpServer.h>
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/Logger.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+回环上UDP每秒收取的数据报个数
+客户端线程各自一个socket(源端口不同 kReusePortPerLoop时分散到不同的subloop)， 用sendmmsg连续发送64字节的数据报
+服务端batchSize决定每次recvmmsg/sendmmsg处理几个数据报， 1相当于逐个recvfrom/sendto
+echo模式下服务端把每个数据报发回去 客户端顺带读掉
+内核接收缓冲区满时丢包 统计的是服务端实际收到的个数
+CPU少的机器上客户端和服务端抢同一个CPU pps主要受客户端限制， 这时比较服务端loop线程每个数据报花费的CPU时间
+
+用法: ./udp_bench [batchSize] [ioThreads] [clientThreads] [seconds] [echo]
+*/
+
+static std::atomic<long> g_received(0);
+static bool g_echo = false;
+static std::mutex g_mutex;
+static std::vector<clockid_t> g_loopClocks;
+
+const size_t kPayload = 64;
+const int kClientBatch = 64;
+
+void onMessage(UdpChannel *channel, const char *data, size_t len, const InetAddress &peer, Timestamp)
+{
+    g_received.fetch_add(1, std::memory_order_relaxed);
+    if (g_echo)
+    {
+        channel->send(peer, data, len);
+    }
+}
+
+// 在loop线程中记录它的CPU时钟
+void threadInit(EventLoop*)
+{
+    clockid_t clock;
+    ::pthread_getcpuclockid(::pthread_self(), &clock);
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_loopClocks.push_back(clock);
+}
+
+double loopCpuSeconds()
+{
+    double total = 0;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    for (clockid_t clock : g_loopClocks)
+    {
+        timespec ts;
+        ::clock_gettime(clock, &ts);
+        total += ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+    return total;
+}
+
+void clientThread(uint16_t port, int seconds, long *sent)
+{
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+
+    char payload[kPayload];
+    ::memset(payload, 'x', sizeof payload);
+    iovec iov[kClientBatch];
+    mmsghdr msgs[kClientBatch];
+    ::memset(msgs, 0, sizeof msgs);
+    for (int i = 0; i < kClientBatch; ++i)
+    {
+        iov[i].iov_base = payload;
+        iov[i].iov_len = sizeof payload;
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    char drain[kClientBatch][kPayload];
+    iovec drainIov[kClientBatch];
+    mmsghdr drainMsgs[kClientBatch];
+    ::memset(drainMsgs, 0, sizeof drainMsgs);
+    for (int i = 0; i < kClientBatch; ++i)
+    {
+        drainIov[i].iov_base = drain[i];
+        drainIov[i].iov_len = kPayload;
+        drainMsgs[i].msg_hdr.msg_iov = &drainIov[i];
+        drainMsgs[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    long count = 0;
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        int n = ::sendmmsg(fd, msgs, kClientBatch, 0);
+        if (n > 0)
+        {
+            count += n;
+        }
+        if (g_echo)
+        {
+            while (::recvmmsg(fd, drainMsgs, kClientBatch, MSG_DONTWAIT, nullptr) > 0)
+            {
+            }
+        }
+    }
+    *sent = count;
+    ::close(fd);
+}
+
+int main(int argc, char *argv[])
+{
+    int batchSize = argc > 1 ? atoi(argv[1]) : 64;
+    int ioThreads = argc > 2 ? atoi(argv[2]) : 1;
+    int clientThreads = argc > 3 ? atoi(argv[3]) : 1;
+    int seconds = argc > 4 ? atoi(argv[4]) : 3;
+    g_echo = argc > 5 && std::string(argv[5]) == "echo";
+    uint16_t port = 9985;
+    Logger::setLogLevel(ERROR);
+
+    EventLoop loop;
+    InetAddress listenAddr(port);
+    UdpServer server(&loop, listenAddr, "UdpBench", UdpServer::kReusePortPerLoop);
+    server.setMessageCallback(onMessage);
+    server.setBatchSize(batchSize);
+    server.setThreadNum(ioThreads);
+    server.setThreadInitcallback(threadInit);
+    server.start();
+
+    std::vector<long> sent(clientThreads, 0);
+    double cpuStart = loopCpuSeconds();
+    double cpuSeconds = 0;
+    std::thread driver([&]() {
+        std::vector<std::thread> clients;
+        for (int i = 0; i < clientThreads; ++i)
+        {
+            clients.emplace_back(clientThread, port, seconds, &sent[i]);
+        }
+        for (std::thread &t : clients)
+        {
+            t.join();
+        }
+        cpuSeconds = loopCpuSeconds() - cpuStart;
+        ::usleep(100 * 1000);
+        loop.quit();
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    loop.loop();
+    driver.join();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    long total = 0;
+    for (long n : sent)
+    {
+        total += n;
+    }
+    long received = g_received.load();
+    printf("batchSize=%d ioThreads=%d clientThreads=%d%s\n", batchSize, ioThreads, clientThreads,
+           g_echo ? " echo" : "");
+    printf("sent=%ld received=%ld (%.1f%%)  %.0f pps\n", total, received,
+           total > 0 ? 100.0 * received / total : 0.0, received / elapsed);
+    printf("io loop cpu %.2f s  %.0f ns per datagram\n", cpuSeconds, received > 0 ? cpuSeconds * 1e9 / received : 0.0);
+    if (g_echo)
+    {
+        printf("echoed=%lu\n", static_cast<unsigned long>(server.datagramsSent()));
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/Logger.h>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+同一台机器上 回环TCP 和 Unix域socket 的对比 服务端是同一个TcpServer 只有监听地址不同
+    latency   : 一个连接 发送msgSize字节等待echo 重复rounds次 统计往返时间
+    throughput: 一个连接 客户端连续写totalMB 服务端只读不回 统计服务端收完的时间
+
+用法: ./uds_bench [rounds] [msgSize] [totalMB]
+*/
+
+static std::atomic<bool> g_sink(false);
+static std::atomic<long> g_received(0);
+
+const uint16_t kPort = 9987;
+const char *kPath = "/tmp/mymuduo_uds_bench.sock";
+
+void onConnection(const TcpConnectionPtr &)
+{
+}
+
+void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    if (g_sink.load(std::memory_order_relaxed))
+    {
+        g_received.fetch_add(buf->readableBytes(), std::memory_order_relaxed);
+        buf->retrieveAll();
+    }
+    else
+    {
+        conn->send(buf->retrieveAllAsString());
+    }
+}
+
+int connectTo(const InetAddress &addr)
+{
+    int fd = ::socket(addr.family(), SOCK_STREAM, 0);
+    if (::connect(fd, addr.sockAddr(), addr.sockAddrLen()) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    if (!addr.isUnix())
+    {
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+    }
+    return fd;
+}
+
+bool readFull(int fd, char *buf, size_t len)
+{
+    size_t got = 0;
+    while (got < len)
+    {
+        ssize_t n = ::read(fd, buf + got, len - got);
+        if (n <= 0)
+        {
+            return false;
+        }
+        got += n;
+    }
+    return true;
+}
+
+bool writeFull(int fd, const char *buf, size_t len)
+{
+    size_t done = 0;
+    while (done < len)
+    {
+        ssize_t n = ::write(fd, buf + done, len - done);
+        if (n <= 0)
+        {
+            return false;
+        }
+        done += n;
+    }
+    return true;
+}
+
+struct Result
+{
+    double avgUs;
+    double p50Us;
+    double p99Us;
+    double mbPerSec;
+};
+
+Result runClient(const InetAddress &addr, int rounds, size_t msgSize, long totalMB)
+{
+    Result result;
+    std::vector<char> msg(msgSize, 'x');
+    std::vector<char> reply(msgSize);
+    std::vector<double> rtts;
+    rtts.reserve(rounds);
+
+    g_sink = false;
+    int fd = connectTo(addr);
+    for (int r = 0; r < rounds; ++r)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (!writeFull(fd, msg.data(), msgSize) || !readFull(fd, reply.data(), msgSize))
+        {
+            perror("echo");
+            exit(1);
+        }
+        rtts.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    ::close(fd);
+    double sum = 0;
+    for (double t : rtts)
+    {
+        sum += t;
+    }
+    std::sort(rtts.begin(), rtts.end());
+    result.avgUs = sum / rounds;
+    result.p50Us = rtts[rounds / 2];
+    result.p99Us = rtts[rounds * 99 / 100];
+
+    g_sink = true;
+    g_received = 0;
+    std::vector<char> chunk(64 * 1024, 'y');
+    long total = totalMB * 1024 * 1024;
+    fd = connectTo(addr);
+    auto start = std::chrono::steady_clock::now();
+    for (long sent = 0; sent < total; sent += chunk.size())
+    {
+        if (!writeFull(fd, chunk.data(), chunk.size()))
+        {
+            perror("write");
+            exit(1);
+        }
+    }
+    while (g_received.load() < total)
+    {
+        ::usleep(100);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::close(fd);
+    result.mbPerSec = totalMB / seconds;
+    return result;
+}
+
+Result runServer(const InetAddress &listenAddr, int rounds, size_t msgSize, long totalMB)
+{
+    EventLoop loop;
+    TcpServer server(&loop, listenAddr, "UdsBench");
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.setThreadNum(1);
+    server.start();
+
+    Result result;
+    std::thread client([&]() {
+        result = runClient(listenAddr, rounds, msgSize, totalMB);
+        ::usleep(100 * 1000);
+        loop.quit();
+    });
+    loop.loop();
+    client.join();
+    return result;
+}
+
+void print(const char *name, const Result &r)
+{
+    printf("%-6s rtt avg %6.1f us  p50 %6.1f us  p99 %6.1f us  throughput %7.0f MB/s\n",
+           name, r.avgUs, r.p50Us, r.p99Us, r.mbPerSec);
+}
+
+int main(int argc, char *argv[])
+{
+    int rounds = argc > 1 ? atoi(argv[1]) : 20000;
+    size_t msgSize = argc > 2 ? atoi(argv[2]) : 64;
+    long totalMB = argc > 3 ? atol(argv[3]) : 1024;
+    Logger::setLogLevel(ERROR);
+
+    printf("rounds=%d msgSize=%zu totalMB=%ld\n", rounds, msgSize, totalMB);
+    print("tcp", runServer(InetAddress(kPort), rounds, msgSize, totalMB));
+    print("unix", runServer(InetAddress::fromUnixPath(kPath), rounds, msgSize, totalMB));
+    ::unlink(kPath);
+    return 0;
+}
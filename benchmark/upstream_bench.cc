@@ -0,0 +1,196 @@
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/TcpClient.h>
+#include <mymuduo/UpstreamPool.h>
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/EventLoopThread.h>
+#include <mymuduo/Logger.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/*
+网关访问后端的两种方式
+    pool   : UpstreamPool 保持maxConnections条连接 每条连接上最多pipeline个在途请求
+    connect: 每个请求新建一个TcpClient 收到响应后由后端关闭连接 (后端先关闭 TIME_WAIT留在后端)
+后端在另一个loop线程中 每收到一行请求返回一行16字节的响应
+网关保持concurrency个在途请求 一共发送requests个
+
+用法: ./upstream_bench [pool|connect] [requests] [concurrency] [maxConnections] [pipeline]
+*/
+
+const uint16_t kBackendPort = 9990;
+const std::string kResponse = "ok-response-16b\n";
+
+// 后端: 'c'开头的请求回复之后关闭连接
+void onBackendMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    const char *eol = nullptr;
+    while ((eol = static_cast<const char*>(::memchr(buf->peek(), '\n', buf->readableBytes()))) != nullptr)
+    {
+        bool closeAfter = buf->peek()[0] == 'c';
+        buf->retrieve(eol - buf->peek() + 1);
+        conn->send(kResponse);
+        if (closeAfter)
+        {
+            conn->shutdown();
+        }
+    }
+}
+
+size_t lineFramer(const Buffer *buf)
+{
+    const char *eol = static_cast<const char*>(::memchr(buf->peek(), '\n', buf->readableBytes()));
+    return eol == nullptr ? 0 : eol - buf->peek() + 1;
+}
+
+class Driver
+{
+public:
+    Driver(EventLoop *loop, bool usePool, int requests, int concurrency, int maxConnections, int pipeline)
+        : loop_(loop)
+        , usePool_(usePool)
+        , requests_(requests)
+        , concurrency_(concurrency)
+        , sent_(0)
+        , done_(0)
+        , failed_(0)
+        , backend_(kBackendPort)
+    {
+        if (usePool_)
+        {
+            pool_.reset(new UpstreamPool(loop, "pool", lineFramer));
+            pool_->setMaxConnections(maxConnections);
+            pool_->setMaxPipeline(pipeline);
+        }
+    }
+
+    void start()
+    {
+        start_ = std::chrono::steady_clock::now();
+        for (int i = 0; i < concurrency_ && sent_ < requests_; ++i)
+        {
+            issue();
+        }
+    }
+
+    double seconds() const { return std::chrono::duration<double>(end_ - start_).count(); }
+    int done() const { return done_; }
+    int failed() const { return failed_; }
+    int poolConnections() const { return pool_ ? pool_->numConnections() : 0; }
+
+private:
+    void issue()
+    {
+        ++sent_;
+        if (usePool_)
+        {
+            pool_->call(backend_, "q\n", [this](bool ok, const std::string &) { complete(ok); });
+            return;
+        }
+        // 每个请求一个TcpClient 连接关闭之后在下一轮回调中删除
+        TcpClient *client = new TcpClient(loop_, backend_, "once");
+        clients_[client].reset(client);
+        std::shared_ptr<bool> answered = std::make_shared<bool>(false);
+        client->setConnectionCallback([this, client, answered](const TcpConnectionPtr &conn) {
+            if (conn->connected())
+            {
+                conn->send("c\n");
+                return;
+            }
+            if (!*answered)
+            {
+                complete(false);
+            }
+            loop_->queueInLoop([this, client]() { clients_.erase(client); });
+        });
+        client->setMessageCallback([this, answered](const TcpConnectionPtr &, Buffer *buf, Timestamp) {
+            if (lineFramer(buf) > 0 && !*answered)
+            {
+                buf->retrieveAll();
+                *answered = true;
+                complete(true);
+            }
+        });
+        client->connect();
+    }
+
+    void complete(bool ok)
+    {
+        ++done_;
+        if (!ok)
+        {
+            ++failed_;
+        }
+        if (sent_ < requests_)
+        {
+            issue();
+        }
+        else if (done_ == requests_)
+        {
+            end_ = std::chrono::steady_clock::now();
+            loop_->queueInLoop([this]() { loop_->quit(); });
+        }
+    }
+
+    EventLoop *loop_;
+    bool usePool_;
+    int requests_;
+    int concurrency_;
+    int sent_;
+    int done_;
+    int failed_;
+    InetAddress backend_;
+    std::unique_ptr<UpstreamPool> pool_;
+    std::unordered_map<TcpClient*, std::unique_ptr<TcpClient>> clients_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point end_;
+};
+
+int main(int argc, char *argv[])
+{
+    std::string mode = argc > 1 ? argv[1] : "pool";
+    int requests = argc > 2 ? atoi(argv[2]) : 20000;
+    int concurrency = argc > 3 ? atoi(argv[3]) : 64;
+    int maxConnections = argc > 4 ? atoi(argv[4]) : 4;
+    int pipeline = argc > 5 ? atoi(argv[5]) : 16;
+    Logger::setLogLevel(FATAL);
+
+    EventLoopThread backendThread;
+    EventLoop *backendLoop = backendThread.startLoop();
+    std::unique_ptr<TcpServer> backend;
+    backendLoop->runInLoop([&]() {
+        backend.reset(new TcpServer(backendLoop, InetAddress(kBackendPort), "backend"));
+        backend->setConnectionCallback([](const TcpConnectionPtr &) {});
+        backend->setMessageCallback(onBackendMessage);
+        backend->start();
+    });
+
+    EventLoop loop;
+    Driver driver(&loop, mode == "pool", requests, concurrency, maxConnections, pipeline);
+    loop.runAfter(0.1, [&driver]() { driver.start(); });
+    loop.loop();
+
+    printf("mode=%s requests=%d concurrency=%d", mode.c_str(), requests, concurrency);
+    if (mode == "pool")
+    {
+        printf(" maxConnections=%d pipeline=%d connections=%d", maxConnections, pipeline, driver.poolConnections());
+    }
+    printf("\n%d done %d failed in %.3f s  %.0f req/s\n",
+           driver.done(), driver.failed(), driver.seconds(), driver.done() / driver.seconds());
+
+    // 后端的TcpServer要在它的loop线程中析构
+    std::promise<void> stopped;
+    backendLoop->runInLoop([&]() {
+        backend.reset();
+        stopped.set_value();
+    });
+    stopped.get_future().wait();
+    return 0;
+}
@@ -3,13 +3,29 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 
 
-static int createNonblocking()
+// 连接风暴时每次epoll_wait返回最多accept这么多连接 剩下的留到下一轮 不饿死其他事件
+const int kDefaultMaxAcceptsPerEvent = 64;
+
+// 处理这个连接数据包的CPU 未知时返回-1
+static int incomingCpu(int sockfd)
 {
-    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int cpu = -1;
+    socklen_t len = sizeof cpu;
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0)
+    {
+        return -1;
+    }
+    return cpu;
+}
+
+static int createNonblocking(sa_family_t family)
+{
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (sockfd < 0) 
     {
         LOG_FATAL("%s:%s:%d listen socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
@@ -18,14 +34,32 @@ static int createNonblocking()
 }
 
 Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport)
+    : Acceptor(loop, createNonblocking(listenAddr.family()))
+{
+    acceptSocket_.setReuseAddr(true);
+    acceptSocket_.setReusePort(reuseport);
+    acceptSocket_.bindAddress(listenAddr); 
+}
+
+Acceptor::Acceptor(EventLoop *loop, int listenFd)
     : loop_(loop)
-    , acceptSocket_(createNonblocking())
+    , acceptSocket_(listenFd)
     , acceptChannel_(loop, acceptSocket_.fd())
+    , maxAcceptsPerEvent_(kDefaultMaxAcceptsPerEvent)
+    , readIncomingCpu_(false)
+    , backlog_(Socket::kDefaultListenBacklog)
+    , deferAcceptSeconds_(0)
+    , fastOpenQueueLength_(0)
     , listenning_(false)
+    , idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC))
 {
-    acceptSocket_.setReuseAddr(true);
-    acceptSocket_.setReusePort(true);
-    acceptSocket_.bindAddress(listenAddr); 
+    // 交接过来的fd不一定是非阻塞的
+    int flags = ::fcntl(listenFd, F_GETFL, 0);
+    if (flags < 0 || ::fcntl(listenFd, F_SETFL, flags | O_NONBLOCK) < 0
+        || ::fcntl(listenFd, F_SETFD, FD_CLOEXEC) < 0)
+    {
+        LOG_FATAL("%s:%s:%d invalid listen socket fd=%d err:%d \n", __FILE__, __FUNCTION__, __LINE__, listenFd, errno);
+    }
     // tcpServer -> start  Acceptor listen  新用户连接 执行回调connfd -》channel-》 subloop
     // baseLoop -》 acceptChannel_(listened) -> 
     acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
@@ -37,41 +71,101 @@ Acceptor::~Acceptor()
     acceptChannel_.disableAll();
     // 将channel 从channel 中删除
     acceptChannel_.remove();
+    if (idleFd_ >= 0)
+    {
+        ::close(idleFd_);
+    }
 }
 
 void Acceptor::listen()
 {
     listenning_ = true;
-    acceptSocket_.listen();
+    // 这两项是TCP的选项 Unix域socket不设置
+    bool tcp = acceptSocket_.family() != AF_UNIX;
+    if (tcp && deferAcceptSeconds_ > 0)
+    {
+        acceptSocket_.setDeferAccept(deferAcceptSeconds_);
+    }
+    // TFO的队列要在listen之前设置
+    if (tcp && fastOpenQueueLength_ > 0)
+    {
+        acceptSocket_.setFastOpen(fastOpenQueueLength_);
+    }
+    acceptSocket_.listen(backlog_);
     acceptChannel_.enableReading();
 }
 
+void Acceptor::stopListening()
+{
+    if (!listenning_)
+    {
+        return;
+    }
+    listenning_ = false;
+    acceptChannel_.disableAll();
+}
+
 // listenfd 有事件发生了，  出现新用户连接
+// 一直accept到EAGAIN或者达到maxAcceptsPerEvent_ 再一起交给TcpServer
 void Acceptor::handleRead()
 {
-    // 默认构造
-    InetAddress peerAddr;
-    int connfd = acceptSocket_.accept(&peerAddr);
-    if (connfd >= 0)
+    batch_.clear();
+    for (int i = 0; i < maxAcceptsPerEvent_; ++i)
     {
-        if (newConnectionCallback_)
+        // 默认构造
+        InetAddress peerAddr;
+        int connfd = acceptSocket_.accept(&peerAddr);
+        if (connfd < 0)
+        {
+            if (errno == EMFILE || errno == ENFILE)
+            {
+                LOG_ERROR("%s:%s:%d sockfd reached limit! \n", __FILE__, __FUNCTION__, __LINE__);
+                // 用预留的fd把连接从监听队列中取出来关掉 对端收到FIN 而不是一直等在队列里
+                if (idleFd_ < 0)
+                {
+                    idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+                }
+                if (idleFd_ >= 0)
+                {
+                    ::close(idleFd_);
+                    sockaddr_un addr;
+                    socklen_t len = sizeof addr;
+                    int fd = ::accept(acceptSocket_.fd(), reinterpret_cast<sockaddr*>(&addr), &len);
+                    idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+                    if (fd >= 0)
+                    {
+                        ::close(fd);
+                        if (fdExhaustedCallback_)
+                        {
+                            fdExhaustedCallback_(InetAddress(reinterpret_cast<sockaddr*>(&addr), len));
+                        }
+                        continue;
+                    }
+                }
+            }
+            else if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                LOG_ERROR("%s:%s:%d accept err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+            }
+            break;
+        }
+        if (newConnectionBatchCallback_)
+        {
+            batch_.push_back(AcceptedConnection{connfd, peerAddr, readIncomingCpu_ ? incomingCpu(connfd) : -1});
+        }
+        else if (newConnectionCallback_)
         {
             //在 tcpserver中 实现 具体
-             newConnectionCallback_(connfd, peerAddr); 
-             // 轮询找到subLoop，唤醒，分发当前的新客户端的Channel
+            newConnectionCallback_(connfd, peerAddr); 
+            // 轮询找到subLoop，唤醒，分发当前的新客户端的Channel
         }
         else
         {
             ::close(connfd);
         }
     }
-    else
+    if (!batch_.empty())
     {
-        LOG_ERROR("%s:%s:%d accept err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
-        if (errno == EMFILE)
-        {
-            LOG_ERROR("%s:%s:%d sockfd reached limit! \n", __FILE__, __FUNCTION__, __LINE__);
-        }
+        newConnectionBatchCallback_(batch_);
     }
 }
-    
\ No newline at end of file
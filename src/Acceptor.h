@@ -3,6 +3,9 @@
 #include "Socket.h"
 #include "Channel.h"
 #include "Logger.h" 
+#include "InetAddress.h"
+
+#include <vector>
 
 // 运行在mainloop中的 使用baseLoop
 class Acceptor : noncopyable
@@ -10,14 +13,49 @@ class Acceptor : noncopyable
 public:
 
     using NewConnectionCallback = std::function<void(int sockfd, const InetAddress&)>;
+    // 一次可读事件中accept到的所有连接
+    struct AcceptedConnection
+    {
+        int sockfd;
+        InetAddress peerAddr;
+        int incomingCpu;        // SO_INCOMING_CPU 没有开启或者未知时为-1
+    };
+    using NewConnectionBatchCallback = std::function<void(const std::vector<AcceptedConnection>&)>;
+    // fd用完时 用预留的空闲fd accept之后立刻关闭的连接
+    using FdExhaustedCallback = std::function<void(const InetAddress &peerAddr)>;
     Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport);
+    // 接管一个已经bind(可以已经listen)的监听socket 比如从旧进程交接过来的 见ListenSocketHandoff
+    Acceptor(EventLoop *loop, int listenFd);
     ~Acceptor();
     void setNewConncetionCallback(const NewConnectionCallback &cb)
     {
         newConnectionCallback_ = cb;
     }
+    // 设置之后一次可读事件accept到的连接一起交给cb 优先于newConnectionCallback_
+    void setNewConnectionBatchCallback(const NewConnectionBatchCallback &cb)
+    {
+        newConnectionBatchCallback_ = cb;
+    }
+    void setFdExhaustedCallback(const FdExhaustedCallback &cb) { fdExhaustedCallback_ = cb; }
+    // 每次可读事件最多accept的连接数 直到EAGAIN或者达到上限
+    void setMaxAcceptsPerEvent(int n) { maxAcceptsPerEvent_ = n > 0 ? n : 1; }
+    // 开启之后batch中的每个连接都读取SO_INCOMING_CPU
+    void setReadIncomingCpu(bool on) { readIncomingCpu_ = on; }
+    // 给所在的SO_REUSEPORT组设置按CPU分发的BPF程序 见Socket::setReusePortCpuSteering
+    bool setCpuSteering(const std::vector<int> &cpuOfIndex)
+    {
+        return acceptSocket_.setReusePortCpuSteering(cpuOfIndex);
+    }
+    // 下面三个在listen之前调用 见Socket::listen/setDeferAccept/setFastOpen  默认都不设置
+    void setBacklog(int backlog) { backlog_ = backlog; }
+    void setDeferAccept(int seconds) { deferAcceptSeconds_ = seconds; }
+    void setFastOpen(int queueLength) { fastOpenQueueLength_ = queueLength; }
     bool listenning() {return listenning_;}
+    EventLoop* getLoop() const { return loop_; }
+    int fd() const { return acceptSocket_.fd(); }
     void listen();
+    // 在loop线程中调用 不再accept 但是不关闭监听socket 队列里的连接留给接管它的进程
+    void stopListening();
     
 private :
 
@@ -34,6 +72,16 @@ private :
     //  连接成功 tcpserver 选择subLoop
     // connfd 打包为channel  获取loop
     NewConnectionCallback newConnectionCallback_;
+    NewConnectionBatchCallback newConnectionBatchCallback_;
+    FdExhaustedCallback fdExhaustedCallback_;
+    std::vector<AcceptedConnection> batch_;
+    int maxAcceptsPerEvent_;
+    bool readIncomingCpu_;
+    int backlog_;
+    int deferAcceptSeconds_;
+    int fastOpenQueueLength_;
     bool listenning_;
+    // 预留的fd EMFILE时先关闭它腾出一个fd accept之后再关掉连接 否则监听fd一直可读 loop空转
+    int idleFd_;
     int nextConnId_;
 }; 
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "AsyncLogging.h"
+#include "LogFile.h"
+#include "Timestamp.h"
+
+#include <stdio.h>
+#include <chrono>
+
+AsyncLogging::AsyncLogging(const std::string &basename,
+                        off_t rollSize,
+                        int flushInterval)
+    : flushInterval_(flushInterval)
+    , running_(false)
+    , basename_(basename)
+    , rollSize_(rollSize)
+    , thread_(std::bind(&AsyncLogging::threadFunc, this), "Logging")
+    , threadStarted_(false)
+    , currentBuffer_(new FixedBuffer)
+    , nextBuffer_(new FixedBuffer)
+{
+    buffers_.reserve(16);
+}
+
+AsyncLogging::~AsyncLogging()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void AsyncLogging::start()
+{
+    running_ = true;
+    thread_.start();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!threadStarted_)
+    {
+        cond_.wait(lock);
+    }
+}
+
+void AsyncLogging::stop()
+{
+    running_ = false;
+    cond_.notify_one();
+    thread_.join();
+}
+
+// 前端 运行在各个调用日志的线程中
+void AsyncLogging::append(const char *logline, int len)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (currentBuffer_->avail() > static_cast<size_t>(len))
+    {
+        currentBuffer_->append(logline, len);
+    }
+    else
+    {
+        // 当前buffer写满了 放入待写队列 换上预备buffer
+        buffers_.push_back(std::move(currentBuffer_));
+        if (nextBuffer_)
+        {
+            currentBuffer_ = std::move(nextBuffer_);
+        }
+        else
+        {
+            // 前端写得太快 两块buffer都用完了， 很少发生
+            currentBuffer_.reset(new FixedBuffer);
+        }
+        currentBuffer_->append(logline, len);
+        cond_.notify_one();
+    }
+}
+
+// 后端 运行在单独的日志线程中
+void AsyncLogging::threadFunc()
+{
+    LogFile output(basename_, rollSize_, flushInterval_);
+    // 后端准备两块空闲buffer 用来和前端交换
+    BufferPtr newBuffer1(new FixedBuffer);
+    BufferPtr newBuffer2(new FixedBuffer);
+    BufferVector buffersToWrite;
+    buffersToWrite.reserve(16);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        threadStarted_ = true;
+        cond_.notify_all();
+    }
+
+    while (running_)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (buffers_.empty())
+            {
+                // 没有写满的buffer 最多等待flushInterval_秒 超时也要把currentBuffer_写出去
+                cond_.wait_for(lock, std::chrono::seconds(flushInterval_));
+            }
+            buffers_.push_back(std::move(currentBuffer_));
+            currentBuffer_ = std::move(newBuffer1);
+            buffersToWrite.swap(buffers_);
+            if (!nextBuffer_)
+            {
+                nextBuffer_ = std::move(newBuffer2);
+            }
+        }
+
+        // 以下都在临界区之外执行 不影响前端写日志
+        if (buffersToWrite.size() > 25)
+        {
+            // 日志堆积太多 后端处理不过来， 丢掉多余的只保留两块
+            char buf[256];
+            snprintf(buf, sizeof buf, "Dropped log messages at %s, %zu larger buffers\n",
+                    Timestamp::now().toString().c_str(),
+                    buffersToWrite.size() - 2);
+            fputs(buf, stderr);
+            output.append(buf, static_cast<int>(strlen(buf)));
+            buffersToWrite.erase(buffersToWrite.begin() + 2, buffersToWrite.end());
+        }
+
+        for (const BufferPtr &buffer : buffersToWrite)
+        {
+            output.append(buffer->data(), buffer->length());
+        }
+
+        // 回收两块buffer 供下一轮交换使用， 避免反复分配4MB内存
+        if (buffersToWrite.size() > 2)
+        {
+            buffersToWrite.resize(2);
+        }
+        if (!newBuffer1)
+        {
+            newBuffer1 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer1->reset();
+        }
+        if (!newBuffer2)
+        {
+            newBuffer2 = std::move(buffersToWrite.back());
+            buffersToWrite.pop_back();
+            newBuffer2->reset();
+        }
+        buffersToWrite.clear();
+        output.flush();
+    }
+
+    // stop() 之后 把前端剩余的日志写完再退出
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (const BufferPtr &buffer : buffers_)
+    {
+        output.append(buffer->data(), buffer->length());
+    }
+    buffers_.clear();
+    output.append(currentBuffer_->data(), currentBuffer_->length());
+    currentBuffer_->reset();
+    output.flush();
+}
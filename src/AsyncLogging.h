@@ -0,0 +1,83 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Thread.h"
+
+#include <string.h>
+#include <sys/types.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/*
+异步日志 双缓冲
+    前端： 各个IO线程调用append 只是把日志拷贝到currentBuffer_ 中 (加锁时间很短)
+    后端： 后台线程把写满的buffer交换出来 批量写入LogFile， 写文件不会阻塞IO线程
+
+使用方式：
+    AsyncLogging *g_asyncLog;
+    void asyncOutput(const char *msg, int len) { g_asyncLog->append(msg, len); }
+    Logger::setOutput(asyncOutput);
+*/
+class AsyncLogging : noncopyable
+{
+public:
+    AsyncLogging(const std::string &basename,
+                off_t rollSize,
+                int flushInterval = 3);
+    ~AsyncLogging();
+
+    void append(const char *logline, int len);
+
+    void start();
+    void stop();
+
+private:
+    // 固定大小的日志缓冲区
+    class FixedBuffer : noncopyable
+    {
+    public:
+        FixedBuffer() : cur_(data_) {}
+
+        void append(const char *buf, size_t len)
+        {
+            if (avail() > len)
+            {
+                memcpy(cur_, buf, len);
+                cur_ += len;
+            }
+        }
+        const char* data() const { return data_; }
+        int length() const { return static_cast<int>(cur_ - data_); }
+        size_t avail() const { return static_cast<size_t>(end() - cur_); }
+        void reset() { cur_ = data_; }
+
+    private:
+        const char* end() const { return data_ + sizeof data_; }
+
+        char data_[4 * 1024 * 1024];
+        char *cur_;
+    };
+
+    using BufferPtr = std::unique_ptr<FixedBuffer>;
+    using BufferVector = std::vector<BufferPtr>;
+
+    void threadFunc();
+
+    const int flushInterval_;   // 后台线程最长等待多少秒写一次文件
+    std::atomic_bool running_;
+    const std::string basename_;
+    const off_t rollSize_;
+    Thread thread_;
+
+    std::mutex mutex_;
+    std::condition_variable cond_;
+    bool threadStarted_;        // 后台线程已经进入循环 start()需要等待
+
+    BufferPtr currentBuffer_;   // 当前正在写入的buffer
+    BufferPtr nextBuffer_;      // 预备buffer currentBuffer_写满后替换
+    BufferVector buffers_;      // 已经写满 等待后台线程写入文件的buffer
+};
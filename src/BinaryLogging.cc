@@ -0,0 +1,269 @@
+#include "BinaryLogging.h"
+
+#include <errno.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+const char BinaryLogging::kFileMagic[8] = {'M', 'B', 'L', 'O', 'G', '0', '1', '\0'};
+
+/*
+每个线程一个环形缓冲区  生产者是写日志的线程 消费者是后台线程
+head_ tail_ 单调递增， 取模得到下标  head_ - tail_ 就是还没写入文件的字节数
+缓冲区满了直接丢弃这条记录并计数， 热路径永远不会阻塞
+*/
+struct BinaryLogging::Ring
+{
+    Ring(size_t size, int tidArg)
+        : buffer(size)
+        , mask(size - 1)
+        , head(0)
+        , tail(0)
+        , dropped(0)
+        , droppedReported(0)
+        , tid(tidArg)
+        , abandoned(false)
+    {
+    }
+
+    std::vector<char> buffer;
+    const size_t mask;
+    std::atomic<uint64_t> head;     // 生产者写入的位置
+    std::atomic<uint64_t> tail;     // 消费者读取的位置
+    std::atomic<uint64_t> dropped;  // 只有生产者修改
+    uint64_t droppedReported;       // 只有消费者使用
+    const int tid;
+    std::atomic_bool abandoned;     // 所属线程已经退出
+};
+
+namespace
+{
+
+__thread void *t_ring = nullptr;
+
+template <typename T>
+void writeValue(FILE *fp, T v)
+{
+    ::fwrite(&v, sizeof v, 1, fp);
+}
+
+size_t roundUpPowerOfTwo(size_t n)
+{
+    size_t size = 1;
+    while (size < n)
+    {
+        size <<= 1;
+    }
+    return size;
+}
+
+} // namespace
+
+BinaryLogging& BinaryLogging::instance()
+{
+    static BinaryLogging logging;
+    return logging;
+}
+
+BinaryLogging::BinaryLogging()
+    : running_(false)
+    , ringSize_(0)
+    , flushIntervalMs_(10)
+    , thread_(std::bind(&BinaryLogging::threadFunc, this), "BinaryLogging")
+    , formatsWritten_(0)
+{
+}
+
+BinaryLogging::~BinaryLogging()
+{
+    if (running_)
+    {
+        stop();
+    }
+}
+
+void BinaryLogging::start(const std::string &filename, size_t ringSize, int flushIntervalMs)
+{
+    filename_ = filename;
+    ringSize_ = roundUpPowerOfTwo(ringSize < kMaxRecordSize * 2 ? kMaxRecordSize * 2 : ringSize);
+    flushIntervalMs_ = flushIntervalMs;
+    running_ = true;
+    thread_.start();
+}
+
+void BinaryLogging::stop()
+{
+    running_ = false;
+    thread_.join();
+}
+
+uint32_t BinaryLogging::registerFormat(int level, const char *file, int line, const char *fmt)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    uint32_t id = static_cast<uint32_t>(formats_.size());
+    formats_.push_back(FormatInfo{id, level, file, line, fmt});
+    return id;
+}
+
+BinaryLogging::Ring* BinaryLogging::threadRing()
+{
+    if (__builtin_expect(t_ring != nullptr, 1))
+    {
+        return static_cast<Ring*>(t_ring);
+    }
+
+    // 线程退出时标记环形缓冲区被遗弃， 后台线程写完剩余数据之后释放
+    struct Holder
+    {
+        std::shared_ptr<Ring> ring;
+        ~Holder()
+        {
+            if (ring)
+            {
+                ring->abandoned = true;
+            }
+            t_ring = nullptr;
+        }
+    };
+    static thread_local Holder holder;
+
+    holder.ring = std::make_shared<Ring>(ringSize_, CurrentThread::tid());
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        rings_.push_back(holder.ring);
+    }
+    t_ring = holder.ring.get();
+    return holder.ring.get();
+}
+
+// 热路径 只有两次memcpy和一次release store
+void BinaryLogging::push(const char *rec, size_t len)
+{
+    Ring *ring = threadRing();
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    if (ring->buffer.size() - (head - tail) < len)
+    {
+        ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1,
+                            std::memory_order_relaxed);
+        return;
+    }
+
+    size_t offset = static_cast<size_t>(head) & ring->mask;
+    size_t first = std::min(len, ring->buffer.size() - offset);
+    memcpy(&ring->buffer[offset], rec, first);
+    memcpy(&ring->buffer[0], rec + first, len - first);
+    ring->head.store(head + len, std::memory_order_release);
+}
+
+void BinaryLogging::threadFunc()
+{
+    FILE *fp = ::fopen(filename_.c_str(), "we");
+    if (fp == nullptr)
+    {
+        ::fprintf(stderr, "BinaryLogging open %s failed %d\n", filename_.c_str(), errno);
+        running_ = false;
+        return;
+    }
+    ::fwrite(kFileMagic, sizeof kFileMagic, 1, fp);
+
+    while (running_)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(flushIntervalMs_));
+        if (drainRings(fp) > 0)
+        {
+            ::fflush(fp);
+        }
+    }
+    // stop() 之后把剩余的记录写完
+    drainRings(fp);
+    ::fclose(fp);
+}
+
+void BinaryLogging::writeFormats(FILE *fp)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (; formatsWritten_ < formats_.size(); ++formatsWritten_)
+    {
+        const FormatInfo &info = formats_[formatsWritten_];
+        writeValue<uint8_t>(fp, kFormatChunk);
+        writeValue<uint32_t>(fp, info.id);
+        writeValue<uint8_t>(fp, static_cast<uint8_t>(info.level));
+        writeValue<uint32_t>(fp, static_cast<uint32_t>(info.line));
+        writeValue<uint16_t>(fp, static_cast<uint16_t>(info.file.size()));
+        ::fwrite(info.file.data(), 1, info.file.size(), fp);
+        writeValue<uint16_t>(fp, static_cast<uint16_t>(info.fmt.size()));
+        ::fwrite(info.fmt.data(), 1, info.fmt.size(), fp);
+    }
+}
+
+// 把所有线程的环形缓冲区写入文件， 返回写入的字节数
+size_t BinaryLogging::drainRings(FILE *fp)
+{
+    struct Snapshot
+    {
+        std::shared_ptr<Ring> ring;
+        bool abandoned;
+        uint64_t head;
+    };
+    std::vector<Snapshot> snapshots;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        snapshots.reserve(rings_.size());
+        for (const std::shared_ptr<Ring> &ring : rings_)
+        {
+            // 先读abandoned再读head， 遗弃之后不会再有新数据
+            bool abandoned = ring->abandoned.load(std::memory_order_acquire);
+            snapshots.push_back(Snapshot{ring, abandoned, ring->head.load(std::memory_order_acquire)});
+        }
+    }
+
+    // 记录一定是在格式串注册之后写入的， 读完head之后再写格式串 保证解码时格式串在前
+    writeFormats(fp);
+
+    size_t total = 0;
+    for (Snapshot &snapshot : snapshots)
+    {
+        Ring *ring = snapshot.ring.get();
+        uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+        uint64_t bytes = snapshot.head - tail;
+        if (bytes > 0)
+        {
+            size_t offset = static_cast<size_t>(tail) & ring->mask;
+            size_t first = std::min(static_cast<size_t>(bytes), ring->buffer.size() - offset);
+            writeValue<uint8_t>(fp, kRecordChunk);
+            writeValue<uint32_t>(fp, static_cast<uint32_t>(bytes));
+            ::fwrite(&ring->buffer[offset], 1, first, fp);
+            ::fwrite(&ring->buffer[0], 1, bytes - first, fp);
+            ring->tail.store(snapshot.head, std::memory_order_release);
+            total += bytes;
+        }
+
+        uint64_t dropped = ring->dropped.load(std::memory_order_relaxed);
+        if (dropped != ring->droppedReported)
+        {
+            writeValue<uint8_t>(fp, kDroppedChunk);
+            writeValue<int32_t>(fp, ring->tid);
+            writeValue<uint64_t>(fp, dropped - ring->droppedReported);
+            ring->droppedReported = dropped;
+        }
+    }
+
+    // 释放已经写完的被遗弃的缓冲区
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (const Snapshot &snapshot : snapshots)
+    {
+        if (snapshot.abandoned)
+        {
+            for (auto it = rings_.begin(); it != rings_.end(); ++it)
+            {
+                if (*it == snapshot.ring)
+                {
+                    rings_.erase(it);
+                    break;
+                }
+            }
+        }
+    }
+    return total;
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Logger.h"
+#include "Timestamp.h"
+#include "CurrentThread.h"
+#include "Thread.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+二进制日志   和LOG_XXX 共用日志级别的过滤规则
+    热路径只记录 格式串ID + 时间戳 + tid + 原始参数， 写入当前线程自己的环形缓冲区(单生产者单消费者 无锁)
+    后台线程定期把各个线程的环形缓冲区批量写入文件， 格式串在第一次出现时写入文件
+    离线使用 tools/blogdecode 把文件还原成和Logger一样的文本格式
+
+BLOG_INFO("TcpConnection::handleRead [%s] %d bytes", conn->name().c_str(), n);
+
+参数和printf一样只支持 整数 浮点数 指针 C字符串， 字符串最多记录255字节
+文件按本机字节序写入， 需要在同一种架构的机器上解码
+*/
+
+#define BLOG_IMPL(level, logmsgFormat, ...) \
+    do \
+    { \
+        if (Logger::logLevel() <= level) \
+        { \
+            static const uint32_t blogFormatId = \
+                BinaryLogging::instance().registerFormat(level, __FILE__, __LINE__, logmsgFormat); \
+            BinaryLogging::instance().record(blogFormatId, ##__VA_ARGS__); \
+        } \
+        if (false) \
+        { \
+            BinaryLogging::checkFormat(logmsgFormat, ##__VA_ARGS__); \
+        } \
+    } while(0)
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_INFO
+    #define BLOG_INFO(logmsgFormat, ...) BLOG_IMPL(INFO, logmsgFormat, ##__VA_ARGS__)
+#else
+    #define BLOG_INFO(logmsgFormat, ...) do {} while(0)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_ERROR
+    #define BLOG_ERROR(logmsgFormat, ...) BLOG_IMPL(ERROR, logmsgFormat, ##__VA_ARGS__)
+#else
+    #define BLOG_ERROR(logmsgFormat, ...) do {} while(0)
+#endif
+
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_DEBUG
+    #define BLOG_DEBUG(logmsgFormat, ...) BLOG_IMPL(DEBUG, logmsgFormat, ##__VA_ARGS__)
+#else
+    #define BLOG_DEBUG(logmsgFormat, ...) do {} while(0)
+#endif
+
+class BinaryLogging : noncopyable
+{
+public:
+    // 文件格式  文件头之后是一连串chunk， 每个chunk以一个字节的类型开头
+    static const char kFileMagic[8];    // "MBLOG01"
+    enum ChunkType : uint8_t
+    {
+        kFormatChunk = 'F',     // u32 id, u8 level, u32 line, u16 fileLen, file, u16 fmtLen, fmt
+        kRecordChunk = 'R',     // u32 bytes, 若干条记录
+        kDroppedChunk = 'X',    // i32 tid, u64 丢弃的记录条数
+    };
+    // 每条记录  u32 记录总长度, u32 格式串ID, i64 微秒时间戳, i32 tid, 参数...
+    static const size_t kRecordHeaderSize = 4 + 4 + 8 + 4;
+    static const size_t kMaxRecordSize = 2048;
+    static const size_t kMaxStringArg = 255;
+    // 参数 u8 类型 + 值,  字符串为 u8 长度 + 内容
+    enum ArgType : uint8_t
+    {
+        kInt64 = 1,
+        kUInt64 = 2,
+        kDouble = 3,
+        kString = 4,
+        kPointer = 5,
+    };
+
+    static BinaryLogging& instance();
+
+    // ringSize 每个线程环形缓冲区的大小(会向上取整为2的幂)  flushIntervalMs 后台线程的写入周期
+    void start(const std::string &filename, size_t ringSize = 1024 * 1024, int flushIntervalMs = 10);
+    void stop();
+    bool started() const { return running_; }
+
+    uint32_t registerFormat(int level, const char *file, int line, const char *fmt);
+
+    template <typename... Args>
+    void record(uint32_t formatId, const Args&... args)
+    {
+        if (!running_)
+        {
+            return;
+        }
+        char rec[kMaxRecordSize];
+        char *p = rec + kRecordHeaderSize;
+        char *end = rec + sizeof rec;
+        if (!encodeArgs(p, end, args...))
+        {
+            return;
+        }
+        uint32_t length = static_cast<uint32_t>(p - rec);
+        int64_t micros = Timestamp::now().microSecondsSinceEpoch();
+        int32_t tid = CurrentThread::tid();
+        memcpy(rec, &length, 4);
+        memcpy(rec + 4, &formatId, 4);
+        memcpy(rec + 8, &micros, 8);
+        memcpy(rec + 16, &tid, 4);
+        push(rec, length);
+    }
+
+    // 只用于编译期检查格式串和参数是否匹配
+    static void checkFormat(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+private:
+    struct Ring;
+    struct FormatInfo
+    {
+        uint32_t id;
+        int level;
+        std::string file;
+        int line;
+        std::string fmt;
+    };
+
+    BinaryLogging();
+    ~BinaryLogging();
+
+    void push(const char *rec, size_t len);
+    Ring* threadRing();
+    void threadFunc();
+    void writeFormats(FILE *fp);
+    size_t drainRings(FILE *fp);
+
+    // 参数编码 失败(记录太长)返回false
+    static bool encodeArgs(char *&, char *) { return true; }
+
+    template <typename T, typename... Rest>
+    static bool encodeArgs(char *&p, char *end, const T &first, const Rest&... rest)
+    {
+        return encodeArg(p, end, first) && encodeArgs(p, end, rest...);
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value, bool>::type
+    encodeArg(char *&p, char *end, T v)
+    {
+        return encodeValue(p, end, kInt64, static_cast<int64_t>(v));
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value, bool>::type
+    encodeArg(char *&p, char *end, T v)
+    {
+        return encodeValue(p, end, kUInt64, static_cast<uint64_t>(v));
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_enum<T>::value, bool>::type
+    encodeArg(char *&p, char *end, T v)
+    {
+        return encodeValue(p, end, kInt64, static_cast<int64_t>(v));
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+    encodeArg(char *&p, char *end, T v)
+    {
+        return encodeValue(p, end, kDouble, static_cast<double>(v));
+    }
+
+    template <typename T>
+    static bool encodeArg(char *&p, char *end, const T *v)
+    {
+        return encodeValue(p, end, kPointer, reinterpret_cast<uint64_t>(v));
+    }
+
+    static bool encodeArg(char *&p, char *end, const char *s)
+    {
+        return encodeString(p, end, s, s == nullptr ? 0 : strlen(s));
+    }
+
+    static bool encodeArg(char *&p, char *end, char *s)
+    {
+        return encodeArg(p, end, static_cast<const char*>(s));
+    }
+
+    template <typename V>
+    static bool encodeValue(char *&p, char *end, ArgType type, V v)
+    {
+        if (static_cast<size_t>(end - p) < 1 + sizeof v)
+        {
+            return false;
+        }
+        *p++ = static_cast<char>(type);
+        memcpy(p, &v, sizeof v);
+        p += sizeof v;
+        return true;
+    }
+
+    static bool encodeString(char *&p, char *end, const char *s, size_t len)
+    {
+        if (len > kMaxStringArg)
+        {
+            len = kMaxStringArg;
+        }
+        if (static_cast<size_t>(end - p) < 2 + len)
+        {
+            return false;
+        }
+        *p++ = static_cast<char>(kString);
+        *p++ = static_cast<char>(static_cast<uint8_t>(len));
+        memcpy(p, s, len);
+        p += len;
+        return true;
+    }
+
+    std::atomic_bool running_;
+    std::string filename_;
+    size_t ringSize_;
+    int flushIntervalMs_;
+    Thread thread_;
+
+    std::mutex mutex_;                          // 保护 formats_ rings_
+    std::vector<FormatInfo> formats_;
+    size_t formatsWritten_;                     // 已经写入文件的格式串个数 只在后台线程中使用
+    std::vector<std::shared_ptr<Ring>> rings_;
+};
+
+inline void BinaryLogging::checkFormat(const char *, ...)
+{
+}
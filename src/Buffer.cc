@@ -1,14 +1,15 @@
 #include "Buffer.h"
+#include <algorithm>
 #include <errno.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
 
 // 从fd上读数据 buffer 缓冲区大小是通过readfd返回的值 确定的
-ssize_t Buffer::readFd(int fd, int* saveErrno)
+ssize_t Buffer::readFd(int fd, int* saveErrno, size_t maxBytes)
 {
-    // 栈上的内存空间
-    char extrabuf[65536] = {0};
+    // 栈上的内存空间 只使用readv写入的部分 不需要清零
+    char extrabuf[65536];
     
     // 包含在sys/uio.h
     struct iovec vec[2];
@@ -20,7 +21,19 @@ ssize_t Buffer::readFd(int fd, int* saveErrno)
 
     vec[1].iov_base = extrabuf;
     vec[1].iov_len = sizeof extrabuf;
-    const int iovcnt = (writable < sizeof extrabuf) ?  2 : 1;
+    int iovcnt = (writable < sizeof extrabuf) ?  2 : 1;
+    if (maxBytes > 0)
+    {
+        if (maxBytes <= writable)
+        {
+            vec[0].iov_len = maxBytes;
+            iovcnt = 1;
+        }
+        else if (iovcnt == 2)
+        {
+            vec[1].iov_len = std::min(maxBytes - writable, sizeof extrabuf);
+        }
+    }
     const ssize_t n = ::readv(fd, vec, iovcnt);
     
     if (n < 0)
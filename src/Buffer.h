@@ -29,6 +29,13 @@ public:
     {}
     
     
+    void swap(Buffer &rhs)
+    {
+        buffer_.swap(rhs.buffer_);
+        std::swap(readerIndex_, rhs.readerIndex_);
+        std::swap(writerIndex_, rhs.writerIndex_);
+    }
+
     size_t readableBytes() const
     {
         return writerIndex_ - readerIndex_;
@@ -108,7 +115,8 @@ public:
     }
 
     // 有符号整型ssize_t 从fd上读取数据 从fd上读取数据
-    ssize_t readFd(int fd, int* saveErrno);
+    // maxBytes > 0 时最多读取maxBytes字节 (不超过writable + 64K)
+    ssize_t readFd(int fd, int* saveErrno, size_t maxBytes = 0);
 
     // 通过fd发送数据 
     ssize_t writeFd(int fd, int* saveErrno);
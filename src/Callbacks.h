@@ -1,7 +1,9 @@
 #pragma once
 #include <memory>
 #include <functional>
+#include <stdint.h>
 class Buffer;
+class EventLoop;
 class TcpConnection;
 class Timestamp;
 
@@ -13,5 +15,11 @@ using WriteCompleteCallback = std::function<void (const TcpConnectionPtr &)>;
 
 using MessageCallback  = std::function<void (const TcpConnectionPtr &, Buffer*, Timestamp)>; 
 using HighWaterMarkCallback = std::function<void(const TcpConnectionPtr&, size_t)>;
+// 连接从from迁移到to 在from的loop线程中、连接离开之前调用
+using MigrateCallback = std::function<void(const TcpConnectionPtr&, EventLoop *from, EventLoop *to)>;
+
+// 定时器 见EventLoop::runAfter
+using TimerCallback = std::function<void()>;
+using TimerId = uint64_t;
 
  
\ No newline at end of file
@@ -13,6 +13,7 @@ Channel::Channel(EventLoop *loop, int fd)
     , events_(0)
     , revents_(0)
     , index_(-1)
+    , lowPriority_(false)
     , tied_(false)
     {
         
@@ -67,7 +68,7 @@ void Channel::handleEvent(Timestamp receiveTime)
 /// @param receiveTime 
 void Channel::handleEventWithGuard(Timestamp receiveTime)
 {
-    LOG_INFO("channel  handleEvent revents:%d\n", revents_);
+    LOG_DEBUG("channel  handleEvent revents:%d\n", revents_);
     
     if ((revents_ & EPOLLHUP) && ! (revents_ & EPOLLIN))
     {
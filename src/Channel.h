@@ -34,6 +34,7 @@ public:
     void setCloseCallback(EventCallback cb ) { closeCallback_ = std::move(cb); }
     void setErrorCallback(EventCallback cb)  { errorCallback_ = std::move(cb); } 
 
+    // 每次事件都要weak_ptr::lock 自己保证在poller中时对象一定存在的(比如TcpConnection)不需要tie
     void tie(const std::shared_ptr<void> &);
     int fd() const {return fd_; }
     int events() const {return events_; }
@@ -52,6 +53,10 @@ public:
     bool isNoneEvent() const {return events_ == kNoneEvent; }
     bool isWriting() const {return events_ & kWriteEvent; }
     bool isReading()  const {return events_ & kReadEvent; }
+
+    // 上次可读事件用完了读预算 还有数据没读 下一轮EventLoop把它排在其他channel之后处理
+    void setLowPriority(bool on) { lowPriority_ = on; }
+    bool lowPriority() const { return lowPriority_; }
     
     
     int index() {return index_;}
@@ -59,6 +64,8 @@ public:
 
     // one loop per thread  当前的channel 属于那个EventLoop
     EventLoop* ownerLoop() {return loop_;}
+    // 连接迁移时使用 调用之前必须已经从原来loop的poller中删除
+    void setOwnerLoop(EventLoop *loop) { loop_ = loop; }
     void remove();
 
 private:
@@ -75,6 +82,7 @@ private:
     int events_;    // 需要监听的的事件
     int revents_;   // poller 返回的已经发生的事件 根据对应的事件执行对应的回调函数
     int index_;     //为什么存在
+    bool lowPriority_;
     
     
     /*
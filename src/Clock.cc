@@ -0,0 +1,294 @@
+#include "Clock.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/time.h>
+#include <atomic>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace
+{
+
+const int64_t kMicroSecondsPerSecond = 1000 * 1000;
+
+// -1 表示还没有初始化 第一次使用时读取环境变量
+std::atomic_int g_source(-1);
+std::once_flag g_initOnce;
+
+const int64_t kRecalibrateIntervalMicros = kMicroSecondsPerSecond;
+// 两次校准之间TSC的估计和gettimeofday相差超过这个值 认为墙上时间跳变了 只重新对齐 不修正频率
+const int64_t kClockStepMicros = 100 * 1000;
+
+// CLOCK_MONOTONIC_COARSE 转换为墙上时间的偏移
+std::atomic<int64_t> g_coarseOffset(0);
+
+// TSC 校准结果   now = g_tscBaseMicros + (rdtsc() - g_tscBase) * g_microsPerTick
+// 三个值要一起读 recalibrate时会更新 用seqlock保护: g_tscSeq为奇数时正在写
+std::atomic<uint32_t> g_tscSeq(0);
+std::atomic<uint64_t> g_tscBase(0);
+std::atomic<int64_t> g_tscBaseMicros(0);
+std::atomic<double> g_microsPerTick(0);
+
+// 下一次校准的时间 (当前时钟源的时间) 抢到的线程负责校准
+std::atomic<int64_t> g_nextRecalibrate(0);
+
+// 每个EventLoop线程在poll返回后记录的时间
+__thread int64_t t_cachedNow = 0;
+
+inline uint64_t rdtsc()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo = 0;
+    uint32_t hi = 0;
+    __asm__ __volatile__("rdtsc" : "=a"(lo), "=d"(hi));
+    return (static_cast<uint64_t>(hi) << 32) | lo;
+#else
+    return 0;
+#endif
+}
+
+int64_t monotonicCoarse()
+{
+    struct timespec ts;
+    ::clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * kMicroSecondsPerSecond + ts.tv_nsec / 1000;
+}
+
+// CPUID.80000007H:EDX[8]  TSC频率恒定 不受睿频和C-state影响
+bool invariantTsc()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007)
+    {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+void calibrateCoarse()
+{
+    g_coarseOffset.store(Clock::realtimeMicroSeconds() - monotonicCoarse(), std::memory_order_relaxed);
+}
+
+// 只有一个线程写
+void storeTscAnchor(uint64_t tsc, int64_t micros, double microsPerTick)
+{
+    uint32_t seq = g_tscSeq.load(std::memory_order_relaxed);
+    g_tscSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    g_tscBase.store(tsc, std::memory_order_relaxed);
+    g_tscBaseMicros.store(micros, std::memory_order_relaxed);
+    g_microsPerTick.store(microsPerTick, std::memory_order_relaxed);
+    g_tscSeq.store(seq + 2, std::memory_order_release);
+}
+
+void loadTscAnchor(uint64_t *tsc, int64_t *micros, double *microsPerTick)
+{
+    for (;;)
+    {
+        uint32_t seq = g_tscSeq.load(std::memory_order_acquire);
+        *tsc = g_tscBase.load(std::memory_order_relaxed);
+        *micros = g_tscBaseMicros.load(std::memory_order_relaxed);
+        *microsPerTick = g_microsPerTick.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((seq & 1) == 0 && g_tscSeq.load(std::memory_order_relaxed) == seq)
+        {
+            return;
+        }
+    }
+}
+
+// 重新对齐到gettimeofday 间隔内没有跳变时按这段时间修正频率 跟上NTP对时钟频率的调整
+void recalibrateTsc()
+{
+    uint64_t base = 0;
+    int64_t baseMicros = 0;
+    double microsPerTick = 0;
+    loadTscAnchor(&base, &baseMicros, &microsPerTick);
+    uint64_t tsc = rdtsc();
+    int64_t micros = Clock::realtimeMicroSeconds();
+    int64_t estimate = baseMicros + static_cast<int64_t>(static_cast<double>(tsc - base) * microsPerTick);
+    int64_t error = micros - estimate;
+    if (tsc > base && micros > baseMicros && error < kClockStepMicros && error > -kClockStepMicros)
+    {
+        microsPerTick = static_cast<double>(micros - baseMicros) / static_cast<double>(tsc - base);
+    }
+    storeTscAnchor(tsc, micros, microsPerTick);
+}
+
+// 用gettimeofday测量20ms内TSC走过的tick数
+bool calibrateTsc()
+{
+    if (!invariantTsc())
+    {
+        return false;
+    }
+    uint64_t tsc0 = rdtsc();
+    int64_t micros0 = Clock::realtimeMicroSeconds();
+    struct timespec req = {0, 20 * 1000 * 1000};
+    ::nanosleep(&req, NULL);
+    uint64_t tsc1 = rdtsc();
+    int64_t micros1 = Clock::realtimeMicroSeconds();
+    if (tsc1 <= tsc0 || micros1 <= micros0)
+    {
+        return false;
+    }
+    storeTscAnchor(tsc1, micros1, static_cast<double>(micros1 - micros0) / static_cast<double>(tsc1 - tsc0));
+    return true;
+}
+
+// 校准并切换时钟源 TSC不可用时退回kRealtime
+Clock::Source applySource(Clock::Source source)
+{
+    if (source == Clock::kMonotonicCoarse)
+    {
+        calibrateCoarse();
+    }
+    else if (source == Clock::kTsc && !calibrateTsc())
+    {
+        source = Clock::kRealtime;
+    }
+    g_source.store(source, std::memory_order_release);
+    return source;
+}
+
+// 第一次使用时读取环境变量 MUDUO_CLOCK
+void initFromEnv()
+{
+    Clock::Source source = Clock::kRealtime;
+    const char *env = ::getenv("MUDUO_CLOCK");
+    if (env != nullptr && ::strcmp(env, "coarse") == 0)
+    {
+        source = Clock::kMonotonicCoarse;
+    }
+    else if (env != nullptr && ::strcmp(env, "tsc") == 0)
+    {
+        source = Clock::kTsc;
+    }
+    applySource(source);
+}
+
+} // namespace
+
+Clock::Source Clock::setSource(Source source)
+{
+    // 显式设置的时钟源优先于环境变量
+    std::call_once(g_initOnce, []() {});
+    return applySource(source);
+}
+
+Clock::Source Clock::source()
+{
+    int source = g_source.load(std::memory_order_acquire);
+    if (__builtin_expect(source < 0, 0))
+    {
+        std::call_once(g_initOnce, initFromEnv);
+        source = g_source.load(std::memory_order_acquire);
+    }
+    return static_cast<Source>(source);
+}
+
+const char* Clock::sourceName(Source source)
+{
+    switch (source)
+    {
+    case kRealtime:
+        return "realtime";
+    case kMonotonicCoarse:
+        return "monotonic_coarse";
+    case kTsc:
+        return "tsc";
+    default:
+        return "unknown";
+    }
+}
+
+int64_t Clock::nowMicroSeconds()
+{
+    switch (source())
+    {
+    case kMonotonicCoarse:
+        return coarseMicroSeconds();
+    case kTsc:
+        return tscMicroSeconds();
+    default:
+        return realtimeMicroSeconds();
+    }
+}
+
+int64_t Clock::realtimeMicroSeconds()
+{
+    struct timeval tv;
+    ::gettimeofday(&tv, NULL);
+    return static_cast<int64_t>(tv.tv_sec) * kMicroSecondsPerSecond + tv.tv_usec;
+}
+
+int64_t Clock::coarseMicroSeconds()
+{
+    return monotonicCoarse() + g_coarseOffset.load(std::memory_order_relaxed);
+}
+
+int64_t Clock::tscMicroSeconds()
+{
+    uint64_t base = 0;
+    int64_t baseMicros = 0;
+    double microsPerTick = 0;
+    loadTscAnchor(&base, &baseMicros, &microsPerTick);
+    return baseMicros + static_cast<int64_t>(static_cast<double>(rdtsc() - base) * microsPerTick);
+}
+
+bool Clock::tscAvailable()
+{
+    return invariantTsc();
+}
+
+int64_t Clock::cachedNow()
+{
+    if (t_cachedNow != 0)
+    {
+        return t_cachedNow;
+    }
+    return nowMicroSeconds();
+}
+
+void Clock::setCachedNow(int64_t microSeconds)
+{
+    t_cachedNow = microSeconds;
+}
+
+void Clock::recalibrate(int64_t now)
+{
+    Source current = source();
+    if (current == kRealtime)
+    {
+        return;
+    }
+    int64_t next = g_nextRecalibrate.load(std::memory_order_relaxed);
+    // 时钟往回跳了很多时 next可能远在将来 也要校准
+    if (now < next && next - now <= kRecalibrateIntervalMicros)
+    {
+        return;
+    }
+    if (!g_nextRecalibrate.compare_exchange_strong(next, now + kRecalibrateIntervalMicros, std::memory_order_relaxed))
+    {
+        return;
+    }
+    if (current == kMonotonicCoarse)
+    {
+        calibrateCoarse();
+    }
+    else
+    {
+        recalibrateTsc();
+    }
+}
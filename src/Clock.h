@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+Timestamp::now() 的时钟源   默认使用gettimeofday
+    kRealtime        gettimeofday   精确 每次都要走vdso
+    kMonotonicCoarse CLOCK_MONOTONIC_COARSE 加上到墙上时间的偏移  精度是一个tick(1~4ms) 非常便宜
+    kTsc             rdtsc 按校准的频率换算  只在x86_64并且CPU支持invariant TSC时可用
+
+选择方式： Clock::setSource(Clock::kTsc) 或者设置环境变量 MUDUO_CLOCK=coarse / tsc
+校准在setSource时完成， 应当在程序启动、创建线程之前调用
+后两个时钟源本身不跟随NTP的调整和时间跳变， EventLoop每轮poll返回后调用Clock::recalibrate
+最多每秒一次重新对齐到gettimeofday (TSC同时修正频率)   没有运行EventLoop的程序不会重新对齐
+
+另外每个EventLoop线程在poll返回后缓存一次当前时间， Clock::cachedNow() 直接读取这个缓存
+*/
+class Clock
+{
+public:
+    enum Source
+    {
+        kRealtime,
+        kMonotonicCoarse,
+        kTsc,
+    };
+
+    // 设置时钟源 TSC不可用时退回kRealtime 返回实际使用的时钟源
+    static Source setSource(Source source);
+    static Source source();
+    static const char* sourceName(Source source);
+
+    // 当前时钟源的时间 自1970年以来的微秒数
+    static int64_t nowMicroSeconds();
+
+    // 各个时钟源单独的接口 benchmark中使用
+    static int64_t realtimeMicroSeconds();
+    static int64_t coarseMicroSeconds();
+    static int64_t tscMicroSeconds();
+    static bool tscAvailable();
+
+    // 当前线程的EventLoop在本轮poll返回时记录的时间， 不读取任何时钟
+    // 当前线程没有EventLoop时 退回nowMicroSeconds()
+    static int64_t cachedNow();
+    static void setCachedNow(int64_t microSeconds);
+
+    // now是当前时钟源的时间 距离上次校准不到1秒时直接返回 kRealtime不需要校准
+    // 可以在多个线程中调用 同一时刻只有一个线程校准
+    static void recalibrate(int64_t now);
+};
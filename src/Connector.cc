@@ -0,0 +1,236 @@
+#include "Connector.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+
+const int Connector::kInitialRetryDelayMs;
+const int Connector::kMaxRetryDelayMs;
+
+static int getSocketError(int sockfd)
+{
+    int optval = 0;
+    socklen_t optlen = sizeof optval;
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0)
+    {
+        return errno;
+    }
+    return optval;
+}
+
+// 本地端口和目的端口相同时 内核会让socket连上自己 Unix域socket不会出现
+static bool isSelfConnect(int sockfd)
+{
+    InetAddress local(InetAddress::getLocalAddr(sockfd));
+    InetAddress peer(InetAddress::getPeerAddr(sockfd));
+    if (local.family() != AF_INET || peer.family() != AF_INET)
+    {
+        return false;
+    }
+    return local.getSockAddr()->sin_port == peer.getSockAddr()->sin_port
+        && local.getSockAddr()->sin_addr.s_addr == peer.getSockAddr()->sin_addr.s_addr;
+}
+
+Connector::Connector(EventLoop *loop, const InetAddress &serverAddr)
+    : loop_(loop)
+    , serverAddr_(serverAddr)
+    , connect_(false)
+    , state_(kDisconnected)
+    , initialRetryDelayMs_(kInitialRetryDelayMs)
+    , maxRetryDelayMs_(kMaxRetryDelayMs)
+    , retryDelayMs_(kInitialRetryDelayMs)
+    , retryTimer_(0)
+{
+    LOG_DEBUG("Connector ctor[%p]\n", this);
+}
+
+Connector::~Connector()
+{
+    LOG_DEBUG("Connector dtor[%p]\n", this);
+}
+
+void Connector::start()
+{
+    connect_ = true;
+    loop_->runInLoop(std::bind(&Connector::startInLoop, shared_from_this()));
+}
+
+void Connector::startInLoop()
+{
+    retryTimer_ = 0;
+    if (connect_ && state_ == kDisconnected)
+    {
+        connect();
+    }
+}
+
+void Connector::stop()
+{
+    connect_ = false;
+    loop_->queueInLoop(std::bind(&Connector::stopInLoop, shared_from_this()));
+}
+
+void Connector::stopInLoop()
+{
+    if (retryTimer_ != 0)
+    {
+        loop_->cancel(retryTimer_);
+        retryTimer_ = 0;
+    }
+    if (state_ == kConnecting)
+    {
+        setState(kDisconnected);
+        int sockfd = removeAndResetChannel();
+        ::close(sockfd);
+    }
+}
+
+void Connector::restart()
+{
+    setState(kDisconnected);
+    retryDelayMs_ = initialRetryDelayMs_;
+    connect_ = true;
+    startInLoop();
+}
+
+void Connector::connect()
+{
+    int sockfd = ::socket(serverAddr_.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sockfd < 0)
+    {
+        LOG_ERROR("%s:%s:%d socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+        retry(-1);
+        return;
+    }
+    int ret = ::connect(sockfd, serverAddr_.sockAddr(), serverAddr_.sockAddrLen());
+    int savedErrno = (ret == 0) ? 0 : errno;
+    switch (savedErrno)
+    {
+        case 0:
+        case EINPROGRESS:
+        case EINTR:
+        case EISCONN:
+            connecting(sockfd);
+            break;
+
+        // 暂时性的错误 稍后重试  ENOENT: Unix域socket的文件还没有创建
+        case EAGAIN:
+        case ENOENT:
+        case EADDRINUSE:
+        case EADDRNOTAVAIL:
+        case ECONNREFUSED:
+        case ENETUNREACH:
+        case ETIMEDOUT:
+            retry(sockfd);
+            break;
+
+        default:
+            LOG_ERROR("Connector::connect %s err:%d \n", serverAddr_.toIpPort().c_str(), savedErrno);
+            ::close(sockfd);
+            setState(kDisconnected);
+            if (connectFailedCallback_)
+            {
+                connectFailedCallback_();
+            }
+            break;
+    }
+}
+
+void Connector::connecting(int sockfd)
+{
+    setState(kConnecting);
+    channel_.reset(new Channel(loop_, sockfd));
+    channel_->setWriteCallback(std::bind(&Connector::handleWrite, this));
+    channel_->setErrorCallback(std::bind(&Connector::handleError, this));
+    // 保证channel的回调执行期间Connector不被析构
+    channel_->tie(shared_from_this());
+    channel_->enableWriting();
+}
+
+int Connector::removeAndResetChannel()
+{
+    channel_->disableAll();
+    channel_->remove();
+    int sockfd = channel_->fd();
+    // 正在channel的handleEvent中 不能在这里删除channel
+    loop_->queueInLoop(std::bind(&Connector::resetChannel, shared_from_this()));
+    return sockfd;
+}
+
+void Connector::resetChannel()
+{
+    channel_.reset();
+}
+
+void Connector::handleWrite()
+{
+    if (state_ != kConnecting)
+    {
+        return;
+    }
+    int sockfd = removeAndResetChannel();
+    int err = getSocketError(sockfd);
+    if (err != 0)
+    {
+        LOG_DEBUG("Connector::handleWrite %s SO_ERROR=%d\n", serverAddr_.toIpPort().c_str(), err);
+        retry(sockfd);
+    }
+    else if (isSelfConnect(sockfd))
+    {
+        LOG_DEBUG("Connector::handleWrite self connect\n");
+        retry(sockfd);
+    }
+    else
+    {
+        setState(kConnected);
+        if (connect_ && newConnectionCallback_)
+        {
+            newConnectionCallback_(sockfd);
+        }
+        else
+        {
+            ::close(sockfd);
+        }
+    }
+}
+
+void Connector::handleError()
+{
+    if (state_ == kConnecting)
+    {
+        int sockfd = removeAndResetChannel();
+        LOG_DEBUG("Connector::handleError SO_ERROR=%d\n", getSocketError(sockfd));
+        retry(sockfd);
+    }
+}
+
+void Connector::retry(int sockfd)
+{
+    if (sockfd >= 0)
+    {
+        ::close(sockfd);
+    }
+    setState(kDisconnected);
+    if (!connect_)
+    {
+        return;
+    }
+    if (connectFailedCallback_)
+    {
+        connectFailedCallback_();
+    }
+    // 回调中可能调用了stop
+    if (!connect_)
+    {
+        return;
+    }
+    LOG_DEBUG("Connector::retry connecting to %s in %d ms\n", serverAddr_.toIpPort().c_str(), retryDelayMs_);
+    retryTimer_ = loop_->runAfter(retryDelayMs_ / 1000.0,
+                                  std::bind(&Connector::startInLoop, shared_from_this()));
+    retryDelayMs_ = std::min(retryDelayMs_ * 2, maxRetryDelayMs_);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Callbacks.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class Channel;
+class EventLoop;
+
+/*
+客户端的非阻塞connect  TcpClient使用
+connect返回EINPROGRESS时把socket打包成Channel关注可写事件， 可写之后用SO_ERROR判断是否连接成功
+失败之后按指数退避重试: 从initialRetryDelayMs开始 每次翻倍 最多maxRetryDelayMs
+连接成功后把sockfd交给newConnectionCallback  sockfd之后归TcpConnection所有
+每次连接失败都调用connectFailedCallback 之后是否重试由错误类型决定
+*/
+class Connector : noncopyable, public std::enable_shared_from_this<Connector>
+{
+public:
+    using NewConnectionCallback = std::function<void(int sockfd)>;
+    using ConnectFailedCallback = std::function<void()>;
+
+    static const int kInitialRetryDelayMs = 500;
+    static const int kMaxRetryDelayMs = 30 * 1000;
+
+    Connector(EventLoop *loop, const InetAddress &serverAddr);
+    ~Connector();
+
+    void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
+    void setConnectFailedCallback(const ConnectFailedCallback &cb) { connectFailedCallback_ = cb; }
+    // 在start之前调用
+    void setRetryDelay(int initialMs, int maxMs) { initialRetryDelayMs_ = initialMs; maxRetryDelayMs_ = maxMs; retryDelayMs_ = initialMs; }
+
+    void start();       // 可以在任意线程中调用
+    void restart();     // 在loop线程中调用 连接断开之后重新连接 退避时间从头开始
+    void stop();        // 可以在任意线程中调用
+
+    const InetAddress& serverAddress() const { return serverAddr_; }
+
+private:
+    enum States { kDisconnected, kConnecting, kConnected };
+
+    void setState(States s) { state_ = s; }
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    void connecting(int sockfd);
+    void handleWrite();
+    void handleError();
+    void retry(int sockfd);
+    int removeAndResetChannel();
+    void resetChannel();
+
+    EventLoop *loop_;
+    InetAddress serverAddr_;
+    std::atomic_bool connect_;
+    States state_;
+    std::unique_ptr<Channel> channel_;
+    NewConnectionCallback newConnectionCallback_;
+    ConnectFailedCallback connectFailedCallback_;
+    int initialRetryDelayMs_;
+    int maxRetryDelayMs_;
+    int retryDelayMs_;
+    TimerId retryTimer_;        // 0表示没有等待中的重试
+};
+
+using ConnectorPtr = std::shared_ptr<Connector>;
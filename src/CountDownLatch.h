@@ -0,0 +1,21 @@
+#pragma once
+
+#include "noncopyable.h"
+#include <mutex>
+#include <condition_variable>
+
+// 计数降为0之前wait一直阻塞  EventLoopThreadPool 用来等待所有loop线程创建好EventLoop
+class CountDownLatch : noncopyable
+{
+public:
+    explicit CountDownLatch(int count);
+
+    void wait();
+    void countDown();
+    int getCount() const;
+
+private:
+    mutable std::mutex mutex_;
+    std::condition_variable cond_;
+    int count_;
+};
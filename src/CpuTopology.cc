@@ -0,0 +1,213 @@
+#include "CpuTopology.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <algorithm>
+#include <fstream>
+#include <set>
+
+namespace
+{
+
+// <numaif.h> 属于libnuma 这里直接使用系统调用
+const int kMpolPreferred = 1;
+
+bool readLine(const std::string &path, std::string *line)
+{
+    std::ifstream in(path.c_str());
+    return static_cast<bool>(std::getline(in, *line));
+}
+
+bool isAllowed(const std::vector<int> &allowed, int cpu)
+{
+    return std::binary_search(allowed.begin(), allowed.end(), cpu);
+}
+
+} // namespace
+
+namespace CpuTopology
+{
+
+std::vector<int> allowedCpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (::sched_getaffinity(0, sizeof set, &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+            {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    if (cpus.empty())
+    {
+        long n = ::sysconf(_SC_NPROCESSORS_ONLN);
+        for (int cpu = 0; cpu < n; ++cpu)
+        {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+std::vector<int> physicalCores()
+{
+    std::vector<int> allowed = allowedCpus();
+    std::vector<int> cores;
+    std::set<int> seen;
+    for (int cpu : allowed)
+    {
+        if (seen.count(cpu))
+        {
+            continue;
+        }
+        std::string siblings;
+        char path[128];
+        snprintf(path, sizeof path, "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list", cpu);
+        if (readLine(path, &siblings))
+        {
+            for (int sibling : parseCpuList(siblings))
+            {
+                seen.insert(sibling);
+            }
+        }
+        cores.push_back(cpu);
+    }
+    return cores;
+}
+
+std::vector<std::vector<int>> numaNodes()
+{
+    std::vector<int> allowed = allowedCpus();
+    std::vector<std::vector<int>> nodes;
+    std::string online;
+    if (readLine("/sys/devices/system/node/online", &online))
+    {
+        for (int node : parseCpuList(online))
+        {
+            std::string cpulist;
+            char path[128];
+            snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node);
+            if (!readLine(path, &cpulist))
+            {
+                continue;
+            }
+            if (static_cast<int>(nodes.size()) <= node)
+            {
+                nodes.resize(node + 1);
+            }
+            for (int cpu : parseCpuList(cpulist))
+            {
+                if (isAllowed(allowed, cpu))
+                {
+                    nodes[node].push_back(cpu);
+                }
+            }
+        }
+    }
+    if (nodes.empty())
+    {
+        nodes.push_back(allowed);
+    }
+    return nodes;
+}
+
+int nodeOfCpu(int cpu)
+{
+    std::vector<std::vector<int>> nodes = numaNodes();
+    for (size_t node = 0; node < nodes.size(); ++node)
+    {
+        if (std::find(nodes[node].begin(), nodes[node].end(), cpu) != nodes[node].end())
+        {
+            return static_cast<int>(node);
+        }
+    }
+    return 0;
+}
+
+bool bindCurrentThread(const std::vector<int> &cpus)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+    {
+        if (cpu >= 0 && cpu < CPU_SETSIZE)
+        {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return ::pthread_setaffinity_np(::pthread_self(), sizeof set, &set) == 0;
+}
+
+bool preferNode(int node)
+{
+    if (node < 0 || node >= 64)
+    {
+        return false;
+    }
+    unsigned long mask = 1UL << node;
+    return ::syscall(SYS_set_mempolicy, kMpolPreferred, &mask, sizeof(mask) * 8) == 0;
+}
+
+std::vector<int> parseCpuList(const std::string &list)
+{
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size())
+    {
+        size_t comma = list.find(',', pos);
+        std::string item = list.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+        size_t dash = item.find('-');
+        if (!item.empty())
+        {
+            int first = atoi(item.c_str());
+            int last = dash == std::string::npos ? first : atoi(item.c_str() + dash + 1);
+            for (int cpu = first; cpu <= last; ++cpu)
+            {
+                cpus.push_back(cpu);
+            }
+        }
+        if (comma == std::string::npos)
+        {
+            break;
+        }
+        pos = comma + 1;
+    }
+    return cpus;
+}
+
+std::string formatCpuList(const std::vector<int> &cpus)
+{
+    std::string result;
+    size_t i = 0;
+    while (i < cpus.size())
+    {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+        {
+            ++j;
+        }
+        if (!result.empty())
+        {
+            result += ',';
+        }
+        result += std::to_string(cpus[i]);
+        if (j > i)
+        {
+            result += '-';
+            result += std::to_string(cpus[j]);
+        }
+        i = j + 1;
+    }
+    return result;
+}
+
+} // namespace CpuTopology
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/*
+CPU拓扑信息 从 /sys/devices/system 读取， 不依赖libnuma
+EventLoopThreadPool 根据这些信息决定每个loop线程绑定在哪些CPU上
+*/
+namespace CpuTopology
+{
+    // 当前进程允许运行的CPU (sched_getaffinity)
+    std::vector<int> allowedCpus();
+
+    // 每个物理核只取一个逻辑CPU (超线程的兄弟CPU只保留编号最小的那个)
+    std::vector<int> physicalCores();
+
+    // 每个NUMA节点上允许运行的CPU 下标就是节点编号， 没有NUMA信息时只有一个节点
+    std::vector<std::vector<int>> numaNodes();
+
+    // CPU所在的NUMA节点 未知时返回0
+    int nodeOfCpu(int cpu);
+
+    // 把当前线程绑定到cpus上 成功返回true
+    bool bindCurrentThread(const std::vector<int> &cpus);
+
+    // 当前线程之后分配的内存优先放在node节点上 (set_mempolicy MPOL_PREFERRED)
+    bool preferNode(int node);
+
+    // 解析 "0-3,8,10-11" 这种格式的CPU列表
+    std::vector<int> parseCpuList(const std::string &list);
+    std::string formatCpuList(const std::vector<int> &cpus);
+}
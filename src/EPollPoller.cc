@@ -6,6 +6,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <strings.h>
+#include <algorithm>
 
 
 // 未添加到poller 中
@@ -36,13 +37,22 @@ EPollPoller::~EPollPoller()
     ::close(epollfd_);
 }
 
+void EPollPoller::reserve(int numChannels)
+{
+    Poller::reserve(numChannels);
+    size_t numEvents = std::min(numChannels, static_cast<int>(kMaxReservedEvents));
+    if (numEvents > events_.size())
+    {
+        events_.resize(numEvents);
+    }
+}
+
 /*
 EventLoop -> poller-> EPollPoller - > poll   通过返回给EevntLoop中 ChannelList中
 */
 Timestamp EPollPoller::poll (int timeoutMs, ChannelList *activeChannels)
 { 
-    // 实际上使用log——debug更加合理 
-    LOG_INFO("func=%s => fd total count: %lu\n", __FUNCTION__, channels_.size()); 
+    LOG_DEBUG("func=%s => fd total count: %lu\n", __FUNCTION__, channels_.size()); 
     
                                             // events_.begin()  返回vector首元素的iterator
                                             //*event_.begin() 首元素 对应的值
@@ -56,7 +66,7 @@ Timestamp EPollPoller::poll (int timeoutMs, ChannelList *activeChannels)
     
     if (numsEvents > 0)
     {
-        LOG_INFO("%d events happened \n",numsEvents);
+        LOG_DEBUG_AT(now, "%d events happened \n", numsEvents);
         
         fillActiveChannels(numsEvents, activeChannels);
         
@@ -108,7 +118,7 @@ void EPollPoller::updateChannel(Channel *channel )
 {
     // channel 的状态
     const int index =  channel->index();
-    LOG_INFO("func=%s fd=%d events=%d idx=%d\n", __FUNCTION__,  channel->fd(), channel->events(), index);
+    LOG_DEBUG("func=%s fd=%d events=%d idx=%d\n", __FUNCTION__,  channel->fd(), channel->events(), index);
     
     // 
     if (index == kNew || index == kDeleted)
@@ -144,7 +154,7 @@ void EPollPoller::updateChannel(Channel *channel )
 void EPollPoller::removeChannel(Channel *channel)
 {
     
-    LOG_INFO("func=%s fd=%d\n", __FUNCTION__,  channel->fd());
+    LOG_DEBUG("func=%s fd=%d\n", __FUNCTION__,  channel->fd());
 
     int fd = channel->fd();
     int index = channel->index();
@@ -21,8 +21,10 @@ public:
     Timestamp poll (int timeoutMs, ChannelList *activeChannels) override;
     void updateChannel(Channel *channel) override;
     void removeChannel(Channel *channel) override;
+    void reserve(int numChannels) override;
 private: 
     static const int kInitEventListSize = 16;
+    static const int kMaxReservedEvents = 4096;  // 一次epoll_wait返回的事件数上限 不需要和channel数一样多
     // 填写活跃的连接
     void fillActiveChannels(int numEvents, ChannelList *activeChannels) const;
     // 更新channel通道
@@ -2,12 +2,18 @@
 #include "Logger.h"
 #include "Poller.h"
 #include "Channel.h"
+#include "Clock.h"
+#include "FixedBlockPool.h"
+#include "TimerQueue.h"
+#include "TcpConnection.h"
 #include <sys/eventfd.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <functional>
+#include <algorithm>
 #include <errno.h>
 #include <memory>
+#include <future>
 
 
 /*
@@ -23,6 +29,9 @@ __thread EventLoop *t_loopInThisThread = nullptr;
 // io复用接口超时的时间
 const int kPollTimeMs = 100000;
 
+// 忙碌时间的统计窗口
+const int64_t kBusyWindowMicros = 100 * 1000;
+
 
 // 调用系统接口  用notify的唤醒subReactor处理新来的Channel
 // 通知subEventLoop
@@ -44,7 +53,17 @@ EventLoop::EventLoop()
     , poller_(Poller::newDefaultPoller(this))
     , wakeupFd_(createEventfd()) // 创建eventFd作为线程间通信机制
     , wakeupChannel_(new Channel(this, wakeupFd_)) // wakeupFd封装为Channel
+    , timerQueue_(new TimerQueue(this))
     , currentActiveChannel_(nullptr) // 当前活跃的channel
+    , cpu_(-1)
+    , numaNode_(-1)
+    , connectionPool_(std::make_shared<FixedBlockPool>())
+    , connections_(0)
+    , busyPermille_(0)
+    , busyUpdatedAt_(0)
+    , polling_(false)
+    , busyWindowStart_(0)
+    , busyMicros_(0)
      
 {
     LOG_DEBUG("EVentLoop created %p in thread %d\n", this,  threadId_);
@@ -67,17 +86,34 @@ EventLoop::EventLoop()
 
 EventLoop::~EventLoop()
 {
+    // 比如loop退出之后才析构的TcpClient 它投递的关闭不会再执行 连接靠pin_永远不会释放
+    // 先换出来 connectDestoryed会调用unpinConnection
+    std::unordered_set<TcpConnection*> pinned;
+    pinned.swap(pinned_);
+    if (!pinned.empty())
+    {
+        LOG_DEBUG("EventLoop %p destroyed with %lu connections, destroying them\n",
+            this, static_cast<unsigned long>(pinned.size()));
+    }
+    for (TcpConnection *conn : pinned)
+    {
+        // 没有其他持有者时 连接在guard出作用域时析构 socket随之关闭
+        TcpConnectionPtr guard(conn->shared_from_this());
+        guard->connectDestoryed();
+    }
     wakeupChannel_->disableAll();
     wakeupChannel_->remove(); 
     ::close(wakeupFd_);
     t_loopInThisThread = nullptr;
+    Clock::setCachedNow(0);
     
 }
 
 void EventLoop::loop()
 {
     looping_ = true;
-    quit_ = false;
+    // 不在开始时重置quit_ 线程池启动时loop指针先交给其他线程， loop()之前就调用了quit也要能退出
+    // 退出循环之后再重置 这个loop还可以再次调用loop()
     
     LOG_INFO("EventLoop %p start looping\n", this);
     while (!quit_)
@@ -85,7 +121,20 @@ void EventLoop::loop()
         activeChannels_.clear();
         // 这里的poll 主要是两种fd
         // 一种是wakeupfd，main和sub 之间唤醒使用，一种是clientFd  客户端通信使用
+        polling_.store(true, std::memory_order_relaxed);
         pollReturnTime_ = poller_->poll(kPollTimeMs, &activeChannels_); 
+        polling_.store(false, std::memory_order_relaxed);
+        // 本轮循环中 Clock::cachedNow() 直接使用poll返回的时间 不再读取时钟
+        Clock::setCachedNow(pollReturnTime_.microSecondsSinceEpoch());
+        // coarse/tsc时钟源最多每秒重新对齐一次墙上时间
+        Clock::recalibrate(pollReturnTime_.microSecondsSinceEpoch());
+        // 超出读预算的连接放到最后 先处理其他连接
+        auto isLow = [](Channel *channel) { return channel->lowPriority(); };
+        if (std::any_of(activeChannels_.begin(), activeChannels_.end(), isLow))
+        {
+            std::stable_partition(activeChannels_.begin(), activeChannels_.end(),
+                                  [](Channel *channel) { return !channel->lowPriority(); });
+        }
         for (Channel *channel :  activeChannels_)
         {
             // poller 监听那些channel发生的事件， 之后上报给EventLoop， 通知Channel处理相应的事件
@@ -104,12 +153,110 @@ void EventLoop::loop()
         mainLoop， 设置回调 需要subLoop执行
         */
         doPendingFunctors();
+        updateBusy(pollReturnTime_.microSecondsSinceEpoch(), Timestamp::now().microSecondsSinceEpoch());
     }
     LOG_INFO("EventLoop %p \n", this); 
+    quit_ = false;
     looping_ = false;   
 }
 
 
+void EventLoop::connectionRemoved()
+{
+    if (connections_.fetch_sub(1, std::memory_order_relaxed) == 1 && drainedCallback_)
+    {
+        Functor cb;
+        cb.swap(drainedCallback_);
+        cb();
+    }
+}
+
+void EventLoop::setDrainedCallback(Functor cb)
+{
+    if (connections() == 0)
+    {
+        cb();
+        return;
+    }
+    drainedCallback_ = std::move(cb);
+}
+
+void EventLoop::setLoopLocal(const void *key, void *value)
+{
+    for (auto it = loopLocals_.begin(); it != loopLocals_.end(); ++it)
+    {
+        if (it->first == key)
+        {
+            if (value == nullptr)
+            {
+                loopLocals_.erase(it);
+            }
+            else
+            {
+                it->second = value;
+            }
+            return;
+        }
+    }
+    if (value != nullptr)
+    {
+        loopLocals_.emplace_back(key, value);
+    }
+}
+
+void* EventLoop::loopLocal(const void *key) const
+{
+    for (const auto &item : loopLocals_)
+    {
+        if (item.first == key)
+        {
+            return item.second;
+        }
+    }
+    return nullptr;
+}
+
+void EventLoop::prewarm(int expectedChannels)
+{
+    poller_->reserve(expectedChannels);
+    activeChannels_.reserve(expectedChannels);
+}
+
+// 窗口内的时间包括阻塞在poll中的时间， 忙碌时间只统计poll返回之后处理事件和回调的部分
+void EventLoop::updateBusy(int64_t start, int64_t end)
+{
+    if (busyWindowStart_ == 0)
+    {
+        busyWindowStart_ = start;
+    }
+    if (end > start)
+    {
+        busyMicros_ += end - start;
+    }
+    int64_t window = end - busyWindowStart_;
+    if (window >= kBusyWindowMicros)
+    {
+        int permille = static_cast<int>(busyMicros_ * 1000 / window);
+        // 和上一个窗口取平均 避免单个窗口的抖动
+        int smoothed = (busyPermille_.load(std::memory_order_relaxed) + permille) / 2;
+        busyPermille_.store(smoothed, std::memory_order_relaxed);
+        busyUpdatedAt_.store(end, std::memory_order_relaxed);
+        busyWindowStart_ = end;
+        busyMicros_ = 0;
+    }
+}
+
+int EventLoop::busyPermille() const
+{
+    // 超过两个窗口没有更新： 阻塞在poll中说明空闲， 否则说明卡在某个回调里
+    int64_t updatedAt = busyUpdatedAt_.load(std::memory_order_relaxed);
+    if (updatedAt != 0 && Clock::cachedNow() - updatedAt > 2 * kBusyWindowMicros)
+    {
+        return polling_.load(std::memory_order_relaxed) ? 0 : 1000;
+    }
+    return busyPermille_.load(std::memory_order_relaxed);
+}
+
 // loop在自己的线程中调用quit
 // 在自己的线程中 
 void EventLoop::quit()
@@ -130,6 +277,30 @@ void EventLoop::quit()
         wakeup(); 
     }
 }
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+{
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delaySeconds, TimerCallback cb)
+{
+    int64_t delay = static_cast<int64_t>(delaySeconds * Timestamp::kMicroSecondsPerSecond);
+    Timestamp time(Timestamp::now().microSecondsSinceEpoch() + delay);
+    return runAt(time, std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double intervalSeconds, TimerCallback cb)
+{
+    int64_t interval = static_cast<int64_t>(intervalSeconds * Timestamp::kMicroSecondsPerSecond);
+    Timestamp time(Timestamp::now().microSecondsSinceEpoch() + interval);
+    return timerQueue_->addTimer(std::move(cb), time, intervalSeconds);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
 void EventLoop::runInLoop(Functor cb)
 {
     if (isInLoopThread())  // 在当前loop线程中执行cb
@@ -142,6 +313,21 @@ void EventLoop::runInLoop(Functor cb)
     }
 }
 
+void EventLoop::runInLoopAndWait(const Functor &cb)
+{
+    if (isInLoopThread())
+    {
+        cb();
+        return;
+    }
+    std::promise<void> done;
+    queueInLoop([&cb, &done]() {
+        cb();
+        done.set_value();
+    });
+    done.get_future().wait();
+}
+
 void EventLoop::queueInLoop(Functor cb)
 {
     {
@@ -1,15 +1,20 @@
 #pragma once
 #include <functional>
 #include <vector>
+#include <unordered_set>
+#include <utility>
 #include <atomic>
 #include <memory> // 智能指针 
 #include <mutex>  // c++ 11 锁机制
 #include "noncopyable.h"
 #include "Timestamp.h"
 #include "CurrentThread.h"
+#include "Callbacks.h"
 
 class Channel;
 class Poller;
+class FixedBlockPool;
+class TimerQueue;
 // 事件循环  主要包含 channel poller (epoll抽象)
 
 class EventLoop : noncopyable
@@ -29,21 +34,61 @@ public:
     
     void runInLoop(Functor cb);     // 在当前的loop中执行cb
     void queueInLoop(Functor cb);    // 将cb放入队列中 唤醒loop所在的线程 执行cb
+    // 在loop线程中执行cb 等它执行完再返回 不能在loop线程等待的其他loop里调用 否则死锁
+    void runInLoopAndWait(const Functor &cb);
     
 
+ 
+    // 定时器 可以在任意线程中调用 cb在loop线程中执行
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    TimerId runAfter(double delaySeconds, TimerCallback cb);
+    TimerId runEvery(double intervalSeconds, TimerCallback cb);
+    void cancel(TimerId timerId);
+
     // mainReactor 唤醒 subReactor 
     void wakeup();                  // 唤醒loop所在的线程
     
     void updateChannel(Channel *channel);   // EventLoop中的方法 
     void removeChannel(Channel *channel); 
     bool hasChannel(Channel *channel);
+    // 本loop上TcpConnection使用的内存池 可以在任意线程中使用
+    const std::shared_ptr<FixedBlockPool>& connectionPool() const { return connectionPool_; }
+
+    // 在loop线程中、开始loop之前调用 预先分配poller的表以及本线程的各个缓冲 接入流量时不再扩容
+    void prewarm(int expectedChannels);
 
     // 判断当前EventLoop 对象是否在创建它自己的线程中 
     bool isInLoopThread() const {return threadId_ == CurrentThread::tid();}
+
+    // 线程的放置信息 由EventLoopThread绑核之后设置
+    // cpu: 只绑定了一个CPU时为该CPU 否则为-1   numaNode: 没有指定节点时为-1
+    void setPlacement(int cpu, int numaNode) { cpu_ = cpu; numaNode_ = numaNode; }
+    int cpu() const { return cpu_; }
+    int numaNode() const { return numaNode_; }
+
+    // 负载信息 EventLoopThreadPool选择subloop时在baseLoop线程中读取
+    // 连接数由TcpConnection在构造和connectDestoryed时维护
+    void connectionAdded() { connections_.fetch_add(1, std::memory_order_relaxed); }
+    void connectionRemoved();       // 在loop线程中调用
+    int connections() const { return connections_.load(std::memory_order_relaxed); }
+    // 在这个loop上建立、还没有connectDestoryed的连接 在loop线程中调用
+    // loop退出之后投递的connectDestoryed不会再执行 析构时替它们执行 解除TcpConnection的自引用
+    void pinConnection(TcpConnection *conn) { pinned_.insert(conn); }
+    void unpinConnection(TcpConnection *conn) { pinned_.erase(conn); }
+    // 在loop线程中调用 连接数降为0时执行cb 调用时已经为0则立即执行 用于回收退役的subloop
+    void setDrainedCallback(Functor cb);
+    // 最近一段时间内处理事件和回调的时间占比 千分比 0~1000
+    int busyPermille() const;
+
+    // 其他组件保存在loop上的本loop数据 key是组件对象的地址 比如TcpServer在每个loop上的连接分片
+    // 只在loop线程中读写 不需要加锁  value为nullptr时删除
+    void setLoopLocal(const void *key, void *value);
+    void* loopLocal(const void *key) const;
     
 private:
     void handleRead();          // wake up
     void doPendingFunctors();   // 执行回调
+    void updateBusy(int64_t start, int64_t end); // 统计本轮循环的忙碌时间
     
 
     // epollPoller 经过poll 操作之后 返回的events 绑定相应的channel
@@ -67,6 +112,7 @@ private:
     // 使用 eventFd创建出来的  int eventfd(unsigned int initval, int flag);
     int wakeupFd_;  
     std::unique_ptr<Channel> wakeupChannel_;  //wakeupChannel 打包了wakeupfd 
+    std::unique_ptr<TimerQueue> timerQueue_;
     
     ChannelList activeChannels_;            // 保存EventLoop下的所有channel 经过poll
     Channel *currentActiveChannel_;
@@ -74,5 +120,21 @@ private:
     std::atomic_bool callingPendingFunctors_;//当前loop 是否有需要执行的回调操作
     std::vector<Functor> pendingFunctors_; //存储loop需要执行的所有的回调操作
     std::mutex mutex_;  // 互斥锁 用来保护上边vector线程安全操作 
+
+    int cpu_;
+    int numaNode_;
+    std::shared_ptr<FixedBlockPool> connectionPool_;
+
+    std::atomic_int connections_;
+    std::unordered_set<TcpConnection*> pinned_;
+    Functor drainedCallback_;
+    // 通常只有一两项 线性查找
+    std::vector<std::pair<const void*, void*>> loopLocals_;
+    // 每个统计窗口结束时更新 busyPermille_ 和 busyUpdatedAt_
+    std::atomic_int busyPermille_;
+    std::atomic<int64_t> busyUpdatedAt_;
+    std::atomic_bool polling_;              // 是否阻塞在poll中 用来判断busyPermille_是否过期
+    int64_t busyWindowStart_;
+    int64_t busyMicros_;
     
 };  
@@ -1,5 +1,8 @@
 #include "EventLoopThread.h"
 #include "EventLoop.h"
+#include "CpuTopology.h"
+#include "CountDownLatch.h"
+#include "Logger.h"
 #include <functional>
 
 
@@ -11,6 +14,9 @@ EventLoopThread::EventLoopThread(const ThreadInitCallback &cb,
         , mutex_()
         , cond_()
         , callback_(cb)
+        , numaNode_(-1)
+        , prewarmChannels_(0)
+        , latch_(nullptr)
         
 {
             
@@ -29,8 +35,18 @@ EventLoopThread::~EventLoopThread()
 
 EventLoop * EventLoopThread::startLoop()
 {
+    start();
+    return waitLoop();
+}
+
+void EventLoopThread::start(CountDownLatch *latch)
+{
+    latch_ = latch;
     thread_.start();        // 启动底层线程thread中的func函数 底层线程的回调函数
-    
+}
+
+EventLoop* EventLoopThread::waitLoop()
+{
     EventLoop *loop = nullptr;
     {
         std::unique_lock<std::mutex> lock(mutex_);
@@ -47,8 +63,28 @@ EventLoop * EventLoopThread::startLoop()
 //下面这个方法:是在单独的新线程里面运行的
 void EventLoopThread::threadFunc()
 {
+    // 先绑核 之后EventLoop Poller 以及后续分配的内存都落在本线程所在的节点上
+    bool bound = !cpus_.empty();
+    if (bound && !CpuTopology::bindCurrentThread(cpus_))
+    {
+        LOG_ERROR("EventLoopThread %s bind cpus %s failed\n",
+                thread_.name().c_str(), CpuTopology::formatCpuList(cpus_).c_str());
+        bound = false;
+    }
+    if (numaNode_ >= 0 && !CpuTopology::preferNode(numaNode_))
+    {
+        LOG_ERROR("EventLoopThread %s set_mempolicy node %d failed\n",
+                thread_.name().c_str(), numaNode_);
+    }
+
     // 创建一个独立的EventLoop， 和上面的线程是一一对应的 重点
     EventLoop loop;
+    // 绑核失败时不能按CPU把连接分给这个loop
+    loop.setPlacement(bound && cpus_.size() == 1 ? cpus_[0] : -1, numaNode_);
+    if (prewarmChannels_ > 0)
+    {
+        loop.prewarm(prewarmChannels_);
+    }
     if (callback_)
     {
         callback_(&loop);
@@ -59,6 +95,10 @@ void EventLoopThread::threadFunc()
         loop_ = &loop;
         cond_.notify_one(); // 和stratLoop 之间返回Loop指针的问题。 
     }
+    if (latch_ != nullptr)
+    {
+        latch_->countDown();
+    }
     // 开启底层的poller
     loop.loop(); // EventLoop loop -> poller.loop
     std::unique_lock<std::mutex> lock(mutex_);
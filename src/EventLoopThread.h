@@ -6,10 +6,12 @@
 #include <mutex>
 #include <condition_variable>
 #include <string>
+#include <vector>
 
 
 class EventLoop;
 class Thread;
+class CountDownLatch;
 
 class EventLoopThread : noncopyable
 {
@@ -19,7 +21,23 @@ public:
         const std::string &name = std::string());
      
     ~EventLoopThread();
+    // 启动线程并等待EventLoop创建完成
     EventLoop* startLoop();
+    // 只启动线程不等待， EventLoop创建完成之后latch->countDown()  多个线程可以同时启动
+    void start(CountDownLatch *latch = nullptr);
+    // 等待并返回EventLoop
+    EventLoop* waitLoop();
+
+    // 在启动之前调用 loop开始之前预先分配expectedChannels个channel需要的空间
+    void setPrewarm(int expectedChannels) { prewarmChannels_ = expectedChannels; }
+
+    // 在startLoop之前调用 线程启动后先绑定到cpus上， numaNode >= 0 时优先在该节点上分配内存
+    // 绑核发生在创建EventLoop之前， 所以loop自己的内存也在本节点上
+    void setPlacement(const std::vector<int> &cpus, int numaNode)
+    {
+        cpus_ = cpus;
+        numaNode_ = numaNode;
+    }
      
 private:
     void threadFunc();
@@ -29,4 +47,9 @@ private:
     std::mutex mutex_;  // 互斥锁
     std::condition_variable cond_; // 条件变量
     ThreadInitCallback callback_;
+
+    std::vector<int> cpus_;
+    int numaNode_;
+    int prewarmChannels_;
+    CountDownLatch *latch_;
 };
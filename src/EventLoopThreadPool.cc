@@ -1,6 +1,11 @@
 #include "EventLoopThreadPool.h"
 #include "EventLoopThread.h"
+#include "EventLoop.h"
+#include "CpuTopology.h"
+#include "CountDownLatch.h"
+#include "Logger.h"
 
+#include <algorithm>
 #include <memory>
 
 
@@ -11,6 +16,12 @@ EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop, const std::string&
     , started_(false)
     , numThreads_(0)
     , next_(0)
+    , nextThreadIndex_(0)
+    , prewarmChannels_(0)
+    , placement_(kNoPlacement)
+    , selection_(kRoundRobin)
+    , random_(std::random_device()())
+    , alive_(std::make_shared<bool>(true))
 
 {
     
@@ -25,17 +36,21 @@ EventLoopThreadPool::~EventLoopThreadPool()
 void EventLoopThreadPool::start(const ThreadInitCallback &cb)
 {
     started_ = true;
+    threadInitCallback_ = cb;
     
+    // 所有线程同时启动 只在latch上等待一次 线程数很多时启动时间不会随线程数线性增长
+    CountDownLatch latch(numThreads_);
     for (int i = 0; i < numThreads_; i++)
     {
-        char buf[name_.size() + 32];
-        snprintf(buf, sizeof buf, "%s%d", name().c_str(), i);
-        EventLoopThread* t = new EventLoopThread(cb, buf);
-        threads_.push_back(std::unique_ptr<EventLoopThread>(t));
-        
+        createThread(nextThreadIndex_++)->start(&latch);
+    }
+    latch.wait();
+    for (std::unique_ptr<EventLoopThread> &t : threads_)
+    {
         // 底层创建线程 绑定一个新的EventLoop 返回Loop的地址 
-        loops_.push_back(t->startLoop());
+        loops_.push_back(t->waitLoop());
     }
+    updateCpuMap();
 
     // numThreads == 0 说明整个服务端只有一个线程， 运行着baseLoop
     if (numThreads_ == 0 && cb)
@@ -44,21 +59,294 @@ void EventLoopThreadPool::start(const ThreadInitCallback &cb)
     }
 }
 
+EventLoopThread* EventLoopThreadPool::createThread(int index)
+{
+    char buf[name_.size() + 32];
+    snprintf(buf, sizeof buf, "%s%d", name().c_str(), index);
+    EventLoopThread* t = new EventLoopThread(threadInitCallback_, buf);
+    threads_.push_back(std::unique_ptr<EventLoopThread>(t));
+
+    int slot = -1;
+    if (placement_ != kNoPlacement)
+    {
+        std::vector<int> cpus;
+        int numaNode = -1;
+        slot = freePlacementSlot();
+        placeThread(slot, &cpus, &numaNode);
+        t->setPlacement(cpus, numaNode);
+        LOG_INFO("EventLoopThreadPool [%s] thread %s -> cpus [%s] numa node %d\n",
+                name_.c_str(), buf, CpuTopology::formatCpuList(cpus).c_str(), numaNode);
+    }
+    threadSlots_.push_back(slot);
+    t->setPrewarm(prewarmChannels_);
+    return t;
+}
+
+EventLoop* EventLoopThreadPool::addLoop()
+{
+    EventLoop *loop = createThread(nextThreadIndex_++)->startLoop();
+    loops_.push_back(loop);
+    updateCpuMap();
+    ++numThreads_;
+    LOG_INFO("EventLoopThreadPool [%s] add loop %p, %d loops\n", name_.c_str(), loop, numThreads_);
+    return loop;
+}
+
+EventLoop* EventLoopThreadPool::retireLoop(EventLoop *loop)
+{
+    if (loops_.empty())
+    {
+        return nullptr;
+    }
+    size_t index = loops_.size() - 1;
+    if (loop != nullptr)
+    {
+        index = std::find(loops_.begin(), loops_.end(), loop) - loops_.begin();
+        if (index == loops_.size())
+        {
+            LOG_ERROR("EventLoopThreadPool [%s] retire unknown loop %p\n", name_.c_str(), loop);
+            return nullptr;
+        }
+    }
+    loop = loops_[index];
+    retiring_[loop] = std::move(threads_[index]);
+    threads_.erase(threads_.begin() + index);
+    threadSlots_.erase(threadSlots_.begin() + index);
+    loops_.erase(loops_.begin() + index);
+    updateCpuMap();
+    --numThreads_;
+    if (static_cast<size_t>(next_) >= loops_.size())
+    {
+        next_ = 0;
+    }
+    LOG_INFO("EventLoopThreadPool [%s] retire loop %p with %d connections\n",
+            name_.c_str(), loop, loop->connections());
+
+    // 连接数的变化发生在loop线程中 到loop线程里等待连接数降为0
+    EventLoop *baseLoop = baseLoop_;
+    std::weak_ptr<bool> alive = alive_;
+    loop->runInLoop([this, loop, baseLoop, alive]() {
+        loop->setDrainedCallback([this, loop, baseLoop, alive]() {
+            baseLoop->queueInLoop([this, loop, alive]() {
+                if (!alive.expired())
+                {
+                    reapLoop(loop);
+                }
+            });
+        });
+    });
+    return loop;
+}
+
+void EventLoopThreadPool::reapLoop(EventLoop *loop)
+{
+    auto it = retiring_.find(loop);
+    if (it == retiring_.end())
+    {
+        return;
+    }
+    LOG_INFO("EventLoopThreadPool [%s] loop %p drained, thread exits\n", name_.c_str(), loop);
+    // EventLoopThread析构时quit并join
+    retiring_.erase(it);
+    if (loopReapedCallback_)
+    {
+        loopReapedCallback_(loop);
+    }
+}
+
+int EventLoopThreadPool::placementSlots() const
+{
+    switch (placement_)
+    {
+    case kCpuList:
+        return static_cast<int>(placementCpus_.size());
+    case kPhysicalCores:
+        return static_cast<int>(CpuTopology::physicalCores().size());
+    case kNumaNodes:
+    {
+        std::vector<std::vector<int>> nodes = CpuTopology::numaNodes();
+        return static_cast<int>(std::count_if(nodes.begin(), nodes.end(),
+            [](const std::vector<int> &cpus) { return !cpus.empty(); }));
+    }
+    default:
+        return 0;
+    }
+}
+
+int EventLoopThreadPool::freePlacementSlot() const
+{
+    int slots = placementSlots();
+    if (slots <= 0)
+    {
+        return 0;
+    }
+    // 退役中的线程不算 它们不再分配新连接 位置让给新线程
+    std::vector<int> users(slots, 0);
+    for (int slot : threadSlots_)
+    {
+        if (slot >= 0 && slot < slots)
+        {
+            ++users[slot];
+        }
+    }
+    return static_cast<int>(std::min_element(users.begin(), users.end()) - users.begin());
+}
+
+void EventLoopThreadPool::placeThread(int slot, std::vector<int> *cpus, int *numaNode) const
+{
+    switch (placement_)
+    {
+    case kCpuList:
+        if (!placementCpus_.empty())
+        {
+            int cpu = placementCpus_[slot % placementCpus_.size()];
+            cpus->push_back(cpu);
+            *numaNode = CpuTopology::nodeOfCpu(cpu);
+        }
+        break;
+
+    case kPhysicalCores:
+    {
+        std::vector<int> cores = CpuTopology::physicalCores();
+        if (!cores.empty())
+        {
+            int cpu = cores[slot % cores.size()];
+            cpus->push_back(cpu);
+            *numaNode = CpuTopology::nodeOfCpu(cpu);
+        }
+        break;
+    }
+
+    case kNumaNodes:
+    {
+        // 跳过没有可用CPU的节点 (只有内存的节点)
+        std::vector<std::vector<int>> nodes = CpuTopology::numaNodes();
+        std::vector<int> usable;
+        for (size_t node = 0; node < nodes.size(); ++node)
+        {
+            if (!nodes[node].empty())
+            {
+                usable.push_back(static_cast<int>(node));
+            }
+        }
+        if (!usable.empty())
+        {
+            int node = usable[slot % usable.size()];
+            *cpus = nodes[node];
+            *numaNode = node;
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
 
 EventLoop* EventLoopThreadPool::getNextLoop()
 {
     EventLoop *loop = baseLoop_;
+    if (loops_.empty())
+    {
+        return loop;
+    }
+    if (selector_)
+    {
+        loop = selector_(loops_);
+        return loop != nullptr ? loop : baseLoop_;
+    }
+    switch (selection_)
+    {
+    case kLeastConnections:
+        return leastLoaded(false);
+    case kLeastBusy:
+        return leastLoaded(true);
+    case kPowerOfTwoChoices:
+        return powerOfTwoChoices();
+    default:
+        break;
+    }
     // 通过轮询获取下一个事件处理的loop
-    if (!loops_.empty())
+    loop = loops_[next_];
+    ++next_;
+    if (static_cast<size_t>(next_) >= loops_.size())
+    {
+        next_ = 0;
+    }
+    return loop;
+}
+
+EventLoop* EventLoopThreadPool::getLoopForCpu(int cpu)
+{
+    if (cpu >= 0 && cpu < static_cast<int>(loopByCpu_.size()) && loopByCpu_[cpu] != nullptr)
+    {
+        return loopByCpu_[cpu];
+    }
+    return getNextLoop();
+}
+
+void EventLoopThreadPool::updateCpuMap()
+{
+    loopByCpu_.clear();
+    for (EventLoop *loop : loops_)
     {
-        loop = loops_[next_];
-        ++next_;
-        if (next_ >= loops_.size())
+        int cpu = loop->cpu();
+        if (cpu < 0)
         {
-            next_ = 0;
+            continue;
+        }
+        if (cpu >= static_cast<int>(loopByCpu_.size()))
+        {
+            loopByCpu_.resize(cpu + 1, nullptr);
+        }
+        // 多个loop绑定同一个CPU时使用第一个
+        if (loopByCpu_[cpu] == nullptr)
+        {
+            loopByCpu_[cpu] = loop;
         }
     }
-    return loop;
+}
+
+// 忙碌时间占比每100ms才更新一次， 按50‰分档之后再比较连接数， 避免同一个窗口内的新连接全部落到同一个loop
+EventLoop* EventLoopThreadPool::leastLoaded(bool byBusy)
+{
+    const int n = static_cast<int>(loops_.size());
+    int best = next_;
+    int bestBusy = byBusy ? loops_[best]->busyPermille() / 50 : 0;
+    int bestConns = loops_[best]->connections();
+    for (int i = 1; i < n; ++i)
+    {
+        int index = (next_ + i) % n;
+        int busy = byBusy ? loops_[index]->busyPermille() / 50 : 0;
+        int conns = loops_[index]->connections();
+        if (busy < bestBusy || (busy == bestBusy && conns < bestConns))
+        {
+            best = index;
+            bestBusy = busy;
+            bestConns = conns;
+        }
+    }
+    next_ = (next_ + 1) % n;
+    return loops_[best];
+}
+
+EventLoop* EventLoopThreadPool::powerOfTwoChoices()
+{
+    const int n = static_cast<int>(loops_.size());
+    if (n == 1)
+    {
+        return loops_[0];
+    }
+    int first = static_cast<int>(random_() % n);
+    // 第二个从剩下的n-1个中选 保证两个不同
+    int second = static_cast<int>((first + 1 + random_() % (n - 1)) % n);
+    EventLoop *a = loops_[first];
+    EventLoop *b = loops_[second];
+    if (a->connections() != b->connections())
+    {
+        return a->connections() < b->connections() ? a : b;
+    }
+    return a->busyPermille() <= b->busyPermille() ? a : b;
 }
 // 
 std::vector<EventLoop*> EventLoopThreadPool:: getAllLoops()
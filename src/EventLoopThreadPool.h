@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <random>
+#include <unordered_map>
 
 class EventLoop;
 class EventLoopThread;
@@ -12,13 +14,60 @@ class EventLoopThreadPool : noncopyable
 {
 public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
+    // 退役的loop线程退出之后在baseLoop线程中调用 这时loop已经析构 指针只能用来查找
+    using LoopReapedCallback = std::function<void(EventLoop*)>;
+
+    // loop线程的放置策略
+    enum Placement
+    {
+        kNoPlacement,       // 不绑核 由调度器决定
+        kCpuList,           // 依次绑定到用户给出的CPU上
+        kPhysicalCores,     // 每个物理核一个线程 不使用超线程的兄弟CPU
+        kNumaNodes,         // 线程轮流分配到各个NUMA节点 绑定到节点内所有CPU 内存从本节点分配
+    };
+
+    // getNextLoop 选择subloop的策略
+    enum Selection
+    {
+        kRoundRobin,            // 轮询
+        kLeastConnections,      // 活跃连接数最少
+        kLeastBusy,             // 最近忙碌时间占比最低 相差不大时比较连接数
+        kPowerOfTwoChoices,     // 随机取两个loop 选连接数少的那个
+    };
+    // 自定义的选择函数 参数是所有的subloop 返回其中一个
+    using LoopSelector = std::function<EventLoop*(const std::vector<EventLoop*>&)>;
+
     EventLoopThreadPool(EventLoop *baseLoop, const std::string& nameArg);
     ~EventLoopThreadPool();
     
     void setThreadNum(int numThreads) { numThreads_ = numThreads; }
+    // 在start之前调用  cpus只在kCpuList时使用
+    void setPlacement(Placement placement, const std::vector<int> &cpus = std::vector<int>())
+    {
+        placement_ = placement;
+        placementCpus_ = cpus;
+    }
+    // 所有loop线程同时启动 等待全部创建好EventLoop之后返回
     void start(const ThreadInitCallback &cb = ThreadInitCallback());
+    // 在start之前调用 每个subloop开始loop之前预先分配expectedChannels个channel需要的空间
+    void setPrewarm(int expectedChannels) { prewarmChannels_ = expectedChannels; }
+
+    // 运行时增减subloop 都要在baseLoop线程中调用
+    // addLoop: 新的loop立即参与getNextLoop的分配
+    EventLoop* addLoop();
+    // retireLoop: loop不再分配新连接， 已有的连接全部关闭之后线程退出并回收 loop为空时退役最后加入的那个
+    // 返回退役的loop 没有subloop时返回nullptr
+    EventLoop* retireLoop(EventLoop *loop = nullptr);
+    int retiringLoops() const { return static_cast<int>(retiring_.size()); }
+    void setLoopReapedCallback(const LoopReapedCallback &cb) { loopReapedCallback_ = cb; }
+
+    void setSelection(Selection selection) { selection_ = selection; }
+    // 设置之后优先于selection_
+    void setLoopSelector(const LoopSelector &selector) { selector_ = selector; }
     
     EventLoop* getNextLoop();
+    // 绑定在cpu上的subloop 没有时退回getNextLoop
+    EventLoop* getLoopForCpu(int cpu);
     // 如果是多线程的话 baseLoop 默认使用轮训的方式分配Channel给subloop
     std::vector<EventLoop*> getAllLoops();
 
@@ -29,16 +78,51 @@ public:
     
     
 private:
+    // 放置策略下可选的位置数: kCpuList的CPU数 kPhysicalCores的物理核数 kNumaNodes有CPU的节点数
+    int placementSlots() const;
+    // 新线程的位置: 第一个没有loop在用的位置 都被占用时选用的loop最少的 (相当于取模)
+    int freePlacementSlot() const;
+    // 计算第slot个位置绑定的CPU以及NUMA节点
+    void placeThread(int slot, std::vector<int> *cpus, int *numaNode) const;
+    // 从next_开始比较 负载相同时依然是轮询的效果
+    EventLoop* leastLoaded(bool byBusy);
+    // 创建第index个loop线程 还没有启动
+    EventLoopThread* createThread(int index);
+    // 退役的loop连接数降为0之后 在baseLoop中结束线程
+    void reapLoop(EventLoop *loop);
+    // loops_变化之后重建loopByCpu_
+    void updateCpuMap();
+    EventLoop* powerOfTwoChoices();
+
     //  用户创建的loop
     EventLoop *baseLoop_;
     std::string name_;
     bool started_; 
     int numThreads_;
     int next_;
+    int nextThreadIndex_;           // 线程名使用的序号 退役之后不复用
+    ThreadInitCallback threadInitCallback_;
+    LoopReapedCallback loopReapedCallback_;
+    int prewarmChannels_;
+
+    Placement placement_;
+    std::vector<int> placementCpus_;
+
+    Selection selection_;
+    LoopSelector selector_;
+    std::minstd_rand random_;
 
     
     // 所有事件的线程 
     std::vector<std::unique_ptr<EventLoopThread>> threads_;
-    // 所有事件线程的eventLoop指针
+    // 所有事件线程的eventLoop指针  和threads_一一对应
     std::vector<EventLoop*> loops_;
+    // 每个线程占用的放置位置 和threads_一一对应 没有放置策略时为-1 退役之后位置可以给新线程
+    std::vector<int> threadSlots_;
+    // 下标是CPU编号 只绑定了一个CPU的loop才会出现在这里
+    std::vector<EventLoop*> loopByCpu_;
+    // 正在退役 等待连接关闭的线程
+    std::unordered_map<EventLoop*, std::unique_ptr<EventLoopThread>> retiring_;
+    // 投递到baseLoop的reapLoop执行时线程池可能已经析构 (比如TcpServer先于baseLoop析构)
+    std::shared_ptr<bool> alive_;
 };
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "FixedBlockPool.h"
+
+#include <new>
+
+FixedBlockPool::FixedBlockPool(size_t maxFreeBlocks)
+    : blockSize_(0)
+    , freeList_(nullptr)
+    , numFree_(0)
+    , maxFreeBlocks_(maxFreeBlocks)
+{
+}
+
+FixedBlockPool::~FixedBlockPool()
+{
+    while (freeList_ != nullptr)
+    {
+        FreeBlock *block = freeList_;
+        freeList_ = block->next;
+        ::operator delete(block);
+    }
+}
+
+void* FixedBlockPool::allocate(size_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (blockSize_ == 0 && size >= sizeof(FreeBlock))
+        {
+            blockSize_ = size;
+        }
+        if (size == blockSize_ && freeList_ != nullptr)
+        {
+            FreeBlock *block = freeList_;
+            freeList_ = block->next;
+            --numFree_;
+            return block;
+        }
+    }
+    return ::operator new(size);
+}
+
+void FixedBlockPool::deallocate(void *p, size_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (size == blockSize_ && numFree_ < maxFreeBlocks_)
+        {
+            FreeBlock *block = static_cast<FreeBlock*>(p);
+            block->next = freeList_;
+            freeList_ = block;
+            ++numFree_;
+            return;
+        }
+    }
+    ::operator delete(p);
+}
+
+size_t FixedBlockPool::freeBlocks() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return numFree_;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "noncopyable.h"
+#include <stddef.h>
+#include <mutex>
+
+/*
+固定大小内存块的对象池  每个EventLoop一个 给TcpConnection使用
+块的大小在第一次分配时确定， 之后大小不同的请求直接使用operator new
+释放的块放回空闲链表重复使用， 超过maxFreeBlocks之后才真正释放
+
+分配一般在baseLoop或者连接所在的loop线程中， 释放在最后一个shared_ptr析构的线程中， 所以需要加锁
+*/
+class FixedBlockPool : noncopyable
+{
+public:
+    explicit FixedBlockPool(size_t maxFreeBlocks = 4096);
+    ~FixedBlockPool();
+
+    void* allocate(size_t size);
+    void deallocate(void *p, size_t size);
+
+    size_t blockSize() const { return blockSize_; }
+    size_t freeBlocks() const;
+
+private:
+    struct FreeBlock
+    {
+        FreeBlock *next;
+    };
+
+    mutable std::mutex mutex_;
+    size_t blockSize_;
+    FreeBlock *freeList_;
+    size_t numFree_;
+    const size_t maxFreeBlocks_;
+};
@@ -1,6 +1,7 @@
-
 #include "InetAddress.h"
+#include "Logger.h"
 
+#include <stddef.h>
 #include <string.h>
 #include <strings.h>
 #include <iostream>
@@ -8,15 +9,94 @@
 
 InetAddress::InetAddress(uint16_t port, std::string ip)
 {
-    //bzero(&addr_, sizeof addr_);
+    ::bzero(&addrUn_, sizeof addrUn_);
     addr_.sin_family = AF_INET;
     addr_.sin_port = htons(port);
     addr_.sin_addr.s_addr = inet_addr(ip.c_str());
+    len_ = sizeof addr_;
+}
+
+InetAddress::InetAddress(const sockaddr *addr, socklen_t len)
+{
+    ::bzero(&addrUn_, sizeof addrUn_);
+    if (len > sizeof addrUn_)
+    {
+        len = sizeof addrUn_;
+    }
+    ::memcpy(&addrUn_, addr, len);
+    len_ = len;
 }
 
+InetAddress InetAddress::fromUnixPath(const std::string &path)
+{
+    sockaddr_un addr;
+    ::bzero(&addr, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    // 抽象命名空间的名字不需要结尾的0 可以用满sun_path
+    bool abstract = !path.empty() && path[0] == '@';
+    size_t maxLen = abstract ? sizeof addr.sun_path : sizeof addr.sun_path - 1;
+    if (path.size() > maxLen)
+    {
+        LOG_FATAL("InetAddress::fromUnixPath path too long (%lu > %lu): %s\n",
+                  static_cast<unsigned long>(path.size()), static_cast<unsigned long>(maxLen), path.c_str());
+    }
+    size_t len = path.size();
+    ::memcpy(addr.sun_path, path.data(), len);
+    if (abstract)
+    {
+        // 抽象命名空间 长度按实际的名字计算 不包括结尾的0
+        addr.sun_path[0] = '\0';
+        return InetAddress(reinterpret_cast<const sockaddr*>(&addr),
+                           static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len));
+    }
+    return InetAddress(reinterpret_cast<const sockaddr*>(&addr),
+                       static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len + 1));
+}
+
+InetAddress InetAddress::getLocalAddr(int sockfd)
+{
+    sockaddr_un addr;
+    ::bzero(&addr, sizeof addr);
+    socklen_t len = sizeof addr;
+    if (::getsockname(sockfd, reinterpret_cast<sockaddr*>(&addr), &len) < 0)
+    {
+        return InetAddress(0, "0.0.0.0");
+    }
+    return InetAddress(reinterpret_cast<const sockaddr*>(&addr), len);
+}
+
+InetAddress InetAddress::getPeerAddr(int sockfd)
+{
+    sockaddr_un addr;
+    ::bzero(&addr, sizeof addr);
+    socklen_t len = sizeof addr;
+    if (::getpeername(sockfd, reinterpret_cast<sockaddr*>(&addr), &len) < 0)
+    {
+        return InetAddress(0, "0.0.0.0");
+    }
+    return InetAddress(reinterpret_cast<const sockaddr*>(&addr), len);
+}
+
+std::string InetAddress::unixPath() const
+{
+    if (!isUnix() || len_ <= offsetof(sockaddr_un, sun_path))
+    {
+        return std::string();
+    }
+    size_t len = len_ - offsetof(sockaddr_un, sun_path);
+    if (addrUn_.sun_path[0] == '\0')
+    {
+        return "@" + std::string(addrUn_.sun_path + 1, len - 1);
+    }
+    return std::string(addrUn_.sun_path, strnlen(addrUn_.sun_path, len));
+}
 
 std::string InetAddress::toIp() const
 {
+    if (isUnix())
+    {
+        return unixPath();
+    }
     char buf[64] = {0};
     //  ntop  网络字节序 转化为 本地字节序
     ::inet_ntop(AF_INET,  &addr_.sin_addr, buf, sizeof buf); 
@@ -26,6 +106,10 @@ std::string InetAddress::toIp() const
 
 std::string InetAddress::toIpPort() const
 {
+    if (isUnix())
+    {
+        return "unix:" + unixPath();
+    }
     char buf[64] = {0};
     ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof buf);
     size_t end = strlen(buf);
@@ -36,12 +120,9 @@ std::string InetAddress::toIpPort() const
 
 uint16_t InetAddress::toPort() const
 {
+    if (isUnix())
+    {
+        return 0;
+    }
     return ntohs(addr_.sin_port);
 }
-
- 
-
-
-
-
-
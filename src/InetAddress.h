@@ -2,20 +2,50 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <string>
 
+/*
+socket地址 IPv4(AF_INET) 或者 Unix域(AF_UNIX)
+Unix域地址的path以'@'开头时使用Linux的抽象命名空间 不在文件系统中创建文件
+*/
 class InetAddress
 {
 public: 
     explicit InetAddress(uint16_t port = 0, std::string ip = "127.0.0.1");
-    explicit InetAddress(const sockaddr_in &addr) : addr_(addr){ }
-    
+    explicit InetAddress(const sockaddr_in &addr) : addr_(addr), len_(sizeof addr) { }
+    // accept/getsockname/getpeername 得到的地址
+    InetAddress(const sockaddr *addr, socklen_t len);
+
+    // Unix域地址 以'@'开头的是抽象命名空间  放不进sun_path的path直接LOG_FATAL
+    // 截断之后会bind/connect到另一个路径 甚至删掉别的文件
+    static InetAddress fromUnixPath(const std::string &path);
+    // sockfd两端的地址 失败时返回AF_INET的0.0.0.0:0
+    static InetAddress getLocalAddr(int sockfd);
+    static InetAddress getPeerAddr(int sockfd);
+
+    sa_family_t family() const { return addr_.sin_family; }
+    bool isUnix() const { return family() == AF_UNIX; }
+
+    // Unix域: toIp是path  toIpPort是"unix:path" 未命名的一端path为空  toPort是0
     std::string toIp() const;
     std::string toIpPort() const;
     uint16_t toPort() const;
+    std::string unixPath() const;
     
+    // 只对AF_INET有意义
     const sockaddr_in* getSockAddr() const {return &addr_; } 
-    void setSockAddr(const sockaddr_in &addr) {addr_ = addr; } 
+    void setSockAddr(const sockaddr_in &addr) {addr_ = addr; len_ = sizeof addr; } 
+
+    // bind/connect使用 适用于所有地址族
+    const sockaddr* sockAddr() const { return reinterpret_cast<const sockaddr*>(&addrUn_); }
+    socklen_t sockAddrLen() const { return len_; }
 private:
-    sockaddr_in addr_;
-};
\ No newline at end of file
+    union
+    {
+        sockaddr_in addr_;
+        sockaddr_un addrUn_;
+    };
+    socklen_t len_;
+};
@@ -0,0 +1,180 @@
+#include "ListenSocketHandoff.h"
+#include "Logger.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+
+// 一次最多交接的fd数
+const size_t kMaxFds = 64;
+// systemd传下来的第一个fd SD_LISTEN_FDS_START
+const int kListenFdsStart = 3;
+
+bool makeUnixAddress(const std::string &path, sockaddr_un *addr)
+{
+    if (path.size() >= sizeof addr->sun_path)
+    {
+        LOG_ERROR("ListenSocketHandoff path too long: %s\n", path.c_str());
+        return false;
+    }
+    ::memset(addr, 0, sizeof *addr);
+    addr->sun_family = AF_UNIX;
+    ::memcpy(addr->sun_path, path.c_str(), path.size());
+    return true;
+}
+
+} // namespace
+
+namespace ListenSocketHandoff
+{
+
+bool sendFds(int unixSocket, const std::vector<int> &fds)
+{
+    if (fds.empty() || fds.size() > kMaxFds)
+    {
+        return false;
+    }
+    // 至少要带1字节的数据 这里发送fd的个数
+    char count = static_cast<char>(fds.size());
+    iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len = 1;
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * fds.size()), 0);
+    msghdr msg;
+    ::memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+    ::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+
+    if (::sendmsg(unixSocket, &msg, MSG_NOSIGNAL) != 1)
+    {
+        LOG_ERROR("ListenSocketHandoff::sendFds errno=%d\n", errno);
+        return false;
+    }
+    return true;
+}
+
+std::vector<int> receiveFds(int unixSocket)
+{
+    std::vector<int> fds;
+    char count = 0;
+    iovec iov;
+    iov.iov_base = &count;
+    iov.iov_len = 1;
+
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * kMaxFds), 0);
+    msghdr msg;
+    ::memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+
+    if (::recvmsg(unixSocket, &msg, MSG_CMSG_CLOEXEC) != 1)
+    {
+        LOG_ERROR("ListenSocketHandoff::receiveFds errno=%d\n", errno);
+        return fds;
+    }
+    for (cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            size_t n = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const int *data = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+            fds.insert(fds.end(), data, data + n);
+        }
+    }
+    if (msg.msg_flags & MSG_CTRUNC)
+    {
+        LOG_ERROR("ListenSocketHandoff::receiveFds control message truncated\n");
+    }
+    return fds;
+}
+
+bool serve(const std::string &path, const std::vector<int> &fds)
+{
+    sockaddr_un addr;
+    if (!makeUnixAddress(path, &addr))
+    {
+        return false;
+    }
+    int listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listenFd < 0)
+    {
+        LOG_ERROR("ListenSocketHandoff::serve socket errno=%d\n", errno);
+        return false;
+    }
+    ::unlink(path.c_str());
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0
+        || ::listen(listenFd, 1) < 0)
+    {
+        LOG_ERROR("ListenSocketHandoff::serve bind %s errno=%d\n", path.c_str(), errno);
+        ::close(listenFd);
+        return false;
+    }
+    int conn = ::accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+    bool ok = conn >= 0 && sendFds(conn, fds);
+    if (conn >= 0)
+    {
+        ::close(conn);
+    }
+    ::close(listenFd);
+    ::unlink(path.c_str());
+    return ok;
+}
+
+std::vector<int> receive(const std::string &path)
+{
+    sockaddr_un addr;
+    if (!makeUnixAddress(path, &addr))
+    {
+        return std::vector<int>();
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return std::vector<int>();
+    }
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        LOG_ERROR("ListenSocketHandoff::receive connect %s errno=%d\n", path.c_str(), errno);
+        ::close(fd);
+        return std::vector<int>();
+    }
+    std::vector<int> fds = receiveFds(fd);
+    ::close(fd);
+    return fds;
+}
+
+std::vector<int> fromSystemd()
+{
+    std::vector<int> fds;
+    const char *pid = ::getenv("LISTEN_PID");
+    const char *count = ::getenv("LISTEN_FDS");
+    if (pid == nullptr || count == nullptr || ::atoi(pid) != ::getpid())
+    {
+        return fds;
+    }
+    int n = ::atoi(count);
+    for (int i = 0; i < n; ++i)
+    {
+        fds.push_back(kListenFdsStart + i);
+    }
+    return fds;
+}
+
+} // namespace ListenSocketHandoff
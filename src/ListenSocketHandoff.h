@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/*
+进程之间交接监听socket 实现不中断服务的重启
+
+    旧进程: fds = server.listenFds();  ListenSocketHandoff::serve(path, fds);  server.stopAccepting();
+            之后等待 server.numConnections() 降为0 再退出
+    新进程: fds = ListenSocketHandoff::receive(path);
+            TcpServer server(&loop, fds, "name", option);  server.start();
+
+监听socket一直处于打开状态 交接期间到达的连接留在内核的accept队列里 由新进程accept
+也支持systemd的socket activation 通过LISTEN_PID/LISTEN_FDS继承
+*/
+namespace ListenSocketHandoff
+{
+    // 通过已连接的unix socket用SCM_RIGHTS发送/接收fd  失败时返回false/空
+    bool sendFds(int unixSocket, const std::vector<int> &fds);
+    std::vector<int> receiveFds(int unixSocket);
+
+    // 在path上监听unix socket 阻塞到一个新进程连接上来 把fds发给它
+    // 会阻塞 不要在EventLoop线程中调用
+    bool serve(const std::string &path, const std::vector<int> &fds);
+    // 连接到旧进程在path上监听的unix socket 接收fds
+    std::vector<int> receive(const std::string &path);
+
+    // systemd socket activation 传下来的fd (从3开始) 没有时返回空
+    std::vector<int> fromSystemd();
+}
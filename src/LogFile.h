@@ -0,0 +1,47 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <stdio.h>
+#include <time.h>
+#include <string>
+
+/*
+滚动日志文件  只由AsyncLogging的后台线程使用， 所以不加锁
+    1. 写满rollSize字节之后 新建一个文件
+    2. 每天零点之后的第一次写入 新建一个文件
+文件名格式： basename.20230101-120000.hostname.pid.log
+*/
+class LogFile : noncopyable
+{
+public:
+    LogFile(const std::string &basename,
+            off_t rollSize,
+            int flushInterval = 3,
+            int checkEveryN = 1024);
+    ~LogFile();
+
+    void append(const char *logline, int len);
+    void flush();
+    bool rollFile();
+
+private:
+    static std::string getLogFileName(const std::string &basename, time_t *now);
+
+    const std::string basename_;
+    const off_t rollSize_;
+    const int flushInterval_;   // 距离上次flush超过多少秒 需要flush
+    const int checkEveryN_;     // 每写多少次检查一次是否需要滚动
+
+    int count_;
+    FILE *fp_;
+    off_t writtenBytes_;        // 当前文件已经写入的字节数
+
+    time_t startOfPeriod_;      // 当前文件所属的那一天 (对齐到零点)
+    time_t lastRoll_;
+    time_t lastFlush_;
+
+    char buffer_[64 * 1024];    // fp_ 的用户态缓冲区
+
+    static const int kRollPerSeconds_ = 60 * 60 * 24;
+};
@@ -1,6 +1,8 @@
 #include "Logger.h"
 #include "Timestamp.h"
-#include <iostream>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
 
 Logger& Logger::instance()
 {
@@ -9,36 +11,164 @@ Logger& Logger::instance()
 }
 
 
-// 日志 级别，time msg
-void Logger::log(std::string msg)
+namespace
+{
+
+void defaultOutput(const char *msg, int len)
+{
+    ::fwrite(msg, 1, len, stdout);
+}
+
+void defaultFlush()
+{
+    ::fflush(stdout);
+}
+
+Logger::OutputFunc g_output = defaultOutput;
+Logger::FlushFunc g_flush = defaultFlush;
+
+const char* levelName(int level)
 {
-    switch (logLevel_)
+    switch (level)
     {
     case INFO:
-        std::cout << "[INFO] ";
-        break;
-
+        return "[INFO] ";
     case ERROR:
-        std::cout << "[ERROR] "; 
-        break;
-        
+        return "[ERROR] ";
     case FATAL:
-        std::cout << "[FATAL] ";
-        break;
-    
+        return "[FATAL] ";
     case DEBUG:
-        std::cout << "[DEBUG] ";
-        break;
-    
+        return "[DEBUG] ";
     default:
-        break;
+        return "";
+    }
+}
+
+// 一行日志的最大长度  消息本身最多1024字节 再加上级别和时间前缀
+const int kMaxLineSize = 1024 + 64;
+
+/*
+每个线程缓存最近一次格式化的 "年/月/日  时:分:秒"
+只有秒数变化时才调用localtime_r和snprintf， 同一秒内只需要拷贝前缀再追加微秒
+*/
+__thread time_t t_lastSecond = -1;
+__thread char t_time[32];
+__thread int t_timeLen = 0;
+
+// 写入 "[级别] 时间:" 前缀， 返回前缀长度
+int formatPrefix(int level, Timestamp time, char *buf)
+{
+    const char *name = levelName(level);
+    int n = static_cast<int>(strlen(name));
+    memcpy(buf, name, n);
+    n += Logger::formatTime(time, buf + n);
+    buf[n++] = ':';
+    return n;
+}
+
+} // namespace
+
+std::atomic_int Logger::logLevel_(MUDUO_MIN_LOG_LEVEL);
+
+int Logger::formatTime(Timestamp time, char *buf)
+{
+    int64_t microSeconds = time.microSecondsSinceEpoch();
+    time_t seconds = static_cast<time_t>(microSeconds / Timestamp::kMicroSecondsPerSecond);
+    int micro = static_cast<int>(microSeconds % Timestamp::kMicroSecondsPerSecond);
+
+    if (seconds != t_lastSecond)
+    {
+        t_lastSecond = seconds;
+        tm tm_time;
+        ::localtime_r(&seconds, &tm_time);
+        t_timeLen = snprintf(t_time, sizeof t_time, "%4d/%02d/%02d  %02d:%02d:%02d",
+                tm_time.tm_year + 1900,
+                tm_time.tm_mon + 1,
+                tm_time.tm_mday,
+                tm_time.tm_hour,
+                tm_time.tm_min,
+                tm_time.tm_sec);
+    }
+    memcpy(buf, t_time, t_timeLen);
+
+    // 微秒固定6位 手动转换 不走snprintf
+    char *p = buf + t_timeLen;
+    *p++ = '.';
+    for (int i = 5; i >= 0; --i)
+    {
+        p[i] = static_cast<char>('0' + micro % 10);
+        micro /= 10;
     }
-    std::cout << Timestamp::now().toString()<< ":" <<  msg << std::endl;
+    return t_timeLen + 7;
 }
 
+// 日志 级别，time msg
+// 整行日志先拼接好，再一次性交给output， 多线程写日志时不会出现交错
+void Logger::log(int level, Timestamp time, const char *msg, int len)
+{
+    char line[kMaxLineSize];
+    int n = formatPrefix(level, time, line);
+    if (len > kMaxLineSize - n - 1)
+    {
+        len = kMaxLineSize - n - 1;
+    }
+    memcpy(line + n, msg, len);
+    n += len;
+    // 大部分调用的格式串已经以\n结尾 不再重复换行
+    if (len == 0 || msg[len - 1] != '\n')
+    {
+        line[n++] = '\n';
+    }
+    g_output(line, n);
+    if (level == FATAL)
+    {
+        // 进程马上exit， 需要把缓冲中的日志刷出去
+        g_flush();
+    }
+}
 
-void Logger::setLogLevel(int level)
+void Logger::log(int level, const char *msg, int len)
 {
-    logLevel_ = level;
+    log(level, Timestamp::now(), msg, len);
 }
 
+void Logger::logf(int level, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vlogf(level, Timestamp::now(), fmt, args);
+    va_end(args);
+}
+
+void Logger::logf(int level, Timestamp time, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    vlogf(level, time, fmt, args);
+    va_end(args);
+}
+
+void Logger::vlogf(int level, Timestamp time, const char *fmt, va_list args)
+{
+    char msg[1024];
+    int len = vsnprintf(msg, sizeof msg, fmt, args);
+    if (len < 0)
+    {
+        return;
+    }
+    if (len >= static_cast<int>(sizeof msg))
+    {
+        len = sizeof msg - 1;
+    }
+    log(level, time, msg, len);
+}
+
+void Logger::setOutput(OutputFunc out)
+{
+    g_output = out;
+}
+
+void Logger::setFlush(FlushFunc flush)
+{
+    g_flush = flush;
+}
@@ -1,74 +1,144 @@
 #pragma once
 
 #include <string>
+#include <atomic>
+#include <stdlib.h>
+#include <stdarg.h>
 
 #include "noncopyable.h"
+#include "Timestamp.h"
+
+/*
+日志级别过滤分两层：
+    1. 编译期  MUDUO_MIN_LOG_LEVEL 以下的日志宏展开为空语句， 参数不会被求值
+    2. 运行期  Logger::setLogLevel 设置全局阈值， 在格式化之前判断， 低于阈值的日志不做snprintf
+每条日志的级别作为参数传给Logger， 不再修改共享的状态， 多线程写日志没有竞争
+*/
+#define MUDUO_LOG_LEVEL_DEBUG 0
+#define MUDUO_LOG_LEVEL_INFO  1
+#define MUDUO_LOG_LEVEL_ERROR 2
+#define MUDUO_LOG_LEVEL_FATAL 3
+
+// 编译的时候通过 -DMUDUO_MIN_LOG_LEVEL=2 只保留ERROR以及FATAL日志
+#ifndef MUDUO_MIN_LOG_LEVEL
+    #ifdef MUDEBUG
+        #define MUDUO_MIN_LOG_LEVEL MUDUO_LOG_LEVEL_DEBUG
+    #else
+        #define MUDUO_MIN_LOG_LEVEL MUDUO_LOG_LEVEL_INFO
+    #endif
+#endif
 
 // LOG_INFO("%s %d", arg1, arg2)
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_INFO
 #define LOG_INFO(logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(INFO); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while(0) 
+        if (Logger::logLevel() <= INFO) \
+        { \
+            Logger::instance().logf(INFO, logmsgFormat, ##__VA_ARGS__); \
+        } \
+    } while(0)
+#else
+    #define LOG_INFO(logmsgFormat, ...) do {} while(0)
+#endif
 
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_ERROR
 #define LOG_ERROR(logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(ERROR); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while(0) 
+        if (Logger::logLevel() <= ERROR) \
+        { \
+            Logger::instance().logf(ERROR, logmsgFormat, ##__VA_ARGS__); \
+        } \
+    } while(0)
+#else
+    #define LOG_ERROR(logmsgFormat, ...) do {} while(0)
+#endif
+
+// 使用调用者已经拿到的时间戳 LOG_INFO_AT(receiveTime, "%d bytes", n)
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_INFO
+#define LOG_INFO_AT(time, logmsgFormat, ...) \
+    do \
+    { \
+        if (Logger::logLevel() <= INFO) \
+        { \
+            Logger::instance().logf(INFO, time, logmsgFormat, ##__VA_ARGS__); \
+        } \
+    } while(0)
+#else
+    #define LOG_INFO_AT(time, logmsgFormat, ...) do {} while(0)
+#endif
 
+// FATAL 日志不能被过滤 一定会退出进程
 #define LOG_FATAL(logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(FATAL); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
+        Logger::instance().logf(FATAL, logmsgFormat, ##__VA_ARGS__); \
         exit(-1); \
-    } while(0) 
+    } while(0)
 
-#ifdef MUDEBUG
+#if MUDUO_MIN_LOG_LEVEL <= MUDUO_LOG_LEVEL_DEBUG
 #define LOG_DEBUG(logmsgFormat, ...) \
     do \
     { \
-        Logger &logger = Logger::instance(); \
-        logger.setLogLevel(DEBUG); \
-        char buf[1024] = {0}; \
-        snprintf(buf, 1024, logmsgFormat, ##__VA_ARGS__); \
-        logger.log(buf); \
-    } while(0) 
+        if (Logger::logLevel() <= DEBUG) \
+        { \
+            Logger::instance().logf(DEBUG, logmsgFormat, ##__VA_ARGS__); \
+        } \
+    } while(0)
+#define LOG_DEBUG_AT(time, logmsgFormat, ...) \
+    do \
+    { \
+        if (Logger::logLevel() <= DEBUG) \
+        { \
+            Logger::instance().logf(DEBUG, time, logmsgFormat, ##__VA_ARGS__); \
+        } \
+    } while(0)
 #else
-    #define LOG_DEBUG(logmsgFormat, ...)
+    #define LOG_DEBUG(logmsgFormat, ...) do {} while(0)
+    #define LOG_DEBUG_AT(time, logmsgFormat, ...) do {} while(0)
 #endif
 
-// 定义日志的级别  INFO  ERROR  FATAL  DEBUG 
+// 定义日志的级别  DEBUG  INFO  ERROR  FATAL  按照严重程度递增
 enum LogLevel
 {
-    INFO,  // 普通信息
-    ERROR, // 错误信息
-    FATAL, // core信息
-    DEBUG, // 调试信息
+    DEBUG = MUDUO_LOG_LEVEL_DEBUG, // 调试信息
+    INFO = MUDUO_LOG_LEVEL_INFO,   // 普通信息
+    ERROR = MUDUO_LOG_LEVEL_ERROR, // 错误信息
+    FATAL = MUDUO_LOG_LEVEL_FATAL, // core信息
 };
 
 // 输出一个日志类
 class Logger : noncopyable
 {
 public:
+    // 日志的输出目的地， 默认写到stdout， 可以替换为AsyncLogging等后端
+    using OutputFunc = void (*)(const char *msg, int len);
+    using FlushFunc = void (*)();
+
     // 获取日志唯一的实例对象
     static Logger& instance();
-    // 设置日志级别
-    void setLogLevel(int level);
-    // 写日志
-    void log(std::string msg);
+    // 设置全局的日志级别阈值， 低于该级别的日志直接丢弃
+    static void setLogLevel(int level) { logLevel_.store(level, std::memory_order_relaxed); }
+    static int logLevel() { return logLevel_.load(std::memory_order_relaxed); }
+
+    // 写日志 每条日志自己携带级别
+    void log(int level, const char *msg, int len);
+    // 使用已经获取的时间戳写日志(比如EventLoop::pollReturnTime)， 不再读取时钟
+    void log(int level, Timestamp time, const char *msg, int len);
+    // 格式化之后写日志， 由LOG_XXX宏在通过阈值检查之后调用
+    void logf(int level, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+    void logf(int level, Timestamp time, const char *fmt, ...) __attribute__((format(printf, 4, 5)));
+
+    // 把时间格式化为 "2023/01/01  12:00:00.123456"， buf至少32字节， 返回长度
+    // 每个线程缓存了当前秒的格式化结果， 同一秒内只追加微秒
+    static int formatTime(Timestamp time, char *buf);
+
+    // 设置输出函数和刷新函数 一般在程序启动时设置一次
+    static void setOutput(OutputFunc out);
+    static void setFlush(FlushFunc flush);
 private:
-    int logLevel_;
-};
\ No newline at end of file
+    void vlogf(int level, Timestamp time, const char *fmt, va_list args);
+
+    static std::atomic_int logLevel_;
+};
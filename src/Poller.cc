@@ -12,5 +12,10 @@ bool Poller::hasChannel(Channel *channel) const
     return  it != channels_.end() &&  it->second == channel;
 }
 
+void Poller::reserve(int numChannels)
+{
+    channels_.reserve(numChannels);
+}
+
 //关于newDefaultPoller的实现问题    为什么不在Poller中 直接实现newDefualtPoller 函数
 // 而去专门 写一个DefaultPoller ？  poller ： 25 mins 
\ No newline at end of file
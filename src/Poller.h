@@ -27,6 +27,9 @@ public:
 
     /// @brief  判断参数Channel中是否存存在poller当中
     virtual bool hasChannel(Channel* channel) const;
+
+    // 预先分配numChannels个channel需要的表项 避免接入流量之后rehash/扩容
+    virtual void reserve(int numChannels);
     
     
     // Eventloop 可以通过该接口获取默认的IO复用的具体实现
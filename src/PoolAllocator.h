@@ -0,0 +1,63 @@
+#pragma once
+
+#include "FixedBlockPool.h"
+#include <stddef.h>
+#include <memory>
+#include <new>
+
+/*
+从FixedBlockPool分配内存的allocator  配合std::allocate_shared使用：
+对象和shared_ptr的控制块在同一块内存里 并且这块内存会被同一个loop上之后的连接重复使用
+控制块里保存了allocator的拷贝， 也就持有pool的shared_ptr， 对象释放之前pool不会被销毁
+*/
+template <typename T>
+class PoolAllocator
+{
+public:
+    using value_type = T;
+
+    explicit PoolAllocator(const std::shared_ptr<FixedBlockPool> &pool)
+        : pool_(pool)
+    {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U> &other)
+        : pool_(other.pool())
+    {}
+
+    T* allocate(size_t n)
+    {
+        if (n != 1)
+        {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+        return static_cast<T*>(pool_->allocate(sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        if (n != 1)
+        {
+            ::operator delete(p);
+            return;
+        }
+        pool_->deallocate(p, sizeof(T));
+    }
+
+    const std::shared_ptr<FixedBlockPool>& pool() const { return pool_; }
+
+private:
+    std::shared_ptr<FixedBlockPool> pool_;
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T> &a, const PoolAllocator<U> &b)
+{
+    return a.pool() == b.pool();
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T> &a, const PoolAllocator<U> &b)
+{
+    return !(a == b);
+}
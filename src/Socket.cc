@@ -1,10 +1,13 @@
 #include "Socket.h"
 #include "Logger.h"
 #include "InetAddress.h"
+#include "SocketOptions.h"
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/tcp.h>
+#include <linux/filter.h>
 #include <strings.h>
+#include <errno.h>
 
 //  listenfd 是从哪里获取的呢 ？
 Socket::~Socket()
@@ -12,16 +15,49 @@ Socket::~Socket()
     close(sockfd_);
 }
 
+// 上一个进程退出时留下的socket文件 连不上说明没有人在监听 可以删掉重新bind
+static bool removeStaleUnixSocket(const InetAddress &addr)
+{
+    std::string path = addr.unixPath();
+    if (path.empty() || path[0] == '@')
+    {
+        return false;
+    }
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool stale = ::connect(fd, addr.sockAddr(), addr.sockAddrLen()) < 0 && errno == ECONNREFUSED;
+    ::close(fd);
+    return stale && ::unlink(path.c_str()) == 0;
+}
+
 void Socket::bindAddress(const InetAddress &localaddr)
 {
-   if ( 0 != bind(sockfd_, (sockaddr*)localaddr.getSockAddr(), sizeof(sockaddr_in)))
+   if (0 != ::bind(sockfd_, localaddr.sockAddr(), localaddr.sockAddrLen()))
    {
-    LOG_FATAL("bind sockfd:%d fail\n", sockfd_);
+       if (errno == EADDRINUSE && localaddr.isUnix() && removeStaleUnixSocket(localaddr)
+           && 0 == ::bind(sockfd_, localaddr.sockAddr(), localaddr.sockAddrLen()))
+       {
+           return;
+       }
+       LOG_FATAL("bind sockfd:%d %s fail errno=%d\n", sockfd_, localaddr.toIpPort().c_str(), errno);
    }
 }
-void Socket::listen()
+
+int Socket::family() const
 {
-    if (0 != ::listen(sockfd_, 1024))
+    int domain = AF_UNSPEC;
+    socklen_t len = sizeof domain;
+    ::getsockopt(sockfd_, SOL_SOCKET, SO_DOMAIN, &domain, &len);
+    return domain;
+}
+const int Socket::kDefaultListenBacklog;
+
+void Socket::listen(int backlog)
+{
+    if (0 != ::listen(sockfd_, backlog))
     {
         LOG_FATAL("listen sockfd:%d fail \n", sockfd_);
     }
@@ -29,14 +65,14 @@ void Socket::listen()
 
 int Socket::accept(InetAddress *peeraddr)
 {
-    sockaddr_in addr;
+    sockaddr_un addr;
     socklen_t len = sizeof addr;
     bzero(&addr, sizeof addr);
     
     int connfd = ::accept4(sockfd_, (sockaddr*)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (connfd >= 0)
     {
-        peeraddr->setSockAddr(addr);
+        *peeraddr = InetAddress((sockaddr*)&addr, len);
     }
     return connfd;
 }
@@ -72,3 +108,138 @@ void Socket::setKeepAlive(bool on)
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof optval);
 }
+
+// 选项设置失败只记录日志 连接继续使用内核的默认值
+static void setIntOption(int sockfd, int level, int optname, int optval, const char *what)
+{
+    if (::setsockopt(sockfd, level, optname, &optval, sizeof optval) < 0)
+    {
+        LOG_ERROR("setsockopt %s=%d on fd=%d failed errno=%d \n", what, optval, sockfd, errno);
+    }
+}
+
+void Socket::setQuickAck(bool on)
+{
+    setIntOption(sockfd_, IPPROTO_TCP, TCP_QUICKACK, on ? 1 : 0, "TCP_QUICKACK");
+}
+
+void Socket::setKeepAliveParams(int idleSeconds, int intervalSeconds, int count)
+{
+    if (idleSeconds > 0)
+    {
+        setIntOption(sockfd_, IPPROTO_TCP, TCP_KEEPIDLE, idleSeconds, "TCP_KEEPIDLE");
+    }
+    if (intervalSeconds > 0)
+    {
+        setIntOption(sockfd_, IPPROTO_TCP, TCP_KEEPINTVL, intervalSeconds, "TCP_KEEPINTVL");
+    }
+    if (count > 0)
+    {
+        setIntOption(sockfd_, IPPROTO_TCP, TCP_KEEPCNT, count, "TCP_KEEPCNT");
+    }
+}
+
+void Socket::setRecvBuffer(int bytes)
+{
+    setIntOption(sockfd_, SOL_SOCKET, SO_RCVBUF, bytes, "SO_RCVBUF");
+}
+
+void Socket::setSendBuffer(int bytes)
+{
+    setIntOption(sockfd_, SOL_SOCKET, SO_SNDBUF, bytes, "SO_SNDBUF");
+}
+
+void Socket::setNotSentLowat(int bytes)
+{
+    setIntOption(sockfd_, IPPROTO_TCP, TCP_NOTSENT_LOWAT, bytes, "TCP_NOTSENT_LOWAT");
+}
+
+void Socket::setUserTimeout(int milliseconds)
+{
+    setIntOption(sockfd_, IPPROTO_TCP, TCP_USER_TIMEOUT, milliseconds, "TCP_USER_TIMEOUT");
+}
+
+void Socket::setDeferAccept(int seconds)
+{
+    setIntOption(sockfd_, IPPROTO_TCP, TCP_DEFER_ACCEPT, seconds, "TCP_DEFER_ACCEPT");
+}
+
+void Socket::setFastOpen(int queueLength)
+{
+    setIntOption(sockfd_, IPPROTO_TCP, TCP_FASTOPEN, queueLength, "TCP_FASTOPEN");
+}
+
+void Socket::setOptions(const SocketOptions &options, int family)
+{
+    // Unix域socket只有收发缓冲区有意义 其余都是TCP的选项
+    if (family == AF_UNIX)
+    {
+        if (options.recvBufferBytes >= 0)
+        {
+            setRecvBuffer(options.recvBufferBytes);
+        }
+        if (options.sendBufferBytes >= 0)
+        {
+            setSendBuffer(options.sendBufferBytes);
+        }
+        return;
+    }
+    setTcpNoDelay(options.tcpNoDelay);
+    setKeepAlive(options.keepAlive);
+    if (options.keepAlive)
+    {
+        setKeepAliveParams(options.keepIdleSeconds, options.keepIntervalSeconds, options.keepCount);
+    }
+    if (options.quickAck)
+    {
+        setQuickAck(true);
+    }
+    if (options.recvBufferBytes >= 0)
+    {
+        setRecvBuffer(options.recvBufferBytes);
+    }
+    if (options.sendBufferBytes >= 0)
+    {
+        setSendBuffer(options.sendBufferBytes);
+    }
+    if (options.notSentLowatBytes >= 0)
+    {
+        setNotSentLowat(options.notSentLowatBytes);
+    }
+    if (options.userTimeoutMs >= 0)
+    {
+        setUserTimeout(options.userTimeoutMs);
+    }
+}
+
+bool Socket::setReusePortCpuSteering(const std::vector<int> &cpuOfIndex)
+{
+    if (cpuOfIndex.empty())
+    {
+        return false;
+    }
+    // A = 当前CPU;  依次比较 相等时返回下标;  都不相等时返回 A % n
+    std::vector<sock_filter> code;
+    code.push_back(BPF_STMT(BPF_LD | BPF_W | BPF_ABS, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)));
+    for (size_t i = 0; i < cpuOfIndex.size(); ++i)
+    {
+        if (cpuOfIndex[i] < 0)
+        {
+            continue;
+        }
+        code.push_back(BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, static_cast<uint32_t>(cpuOfIndex[i]), 0, 1));
+        code.push_back(BPF_STMT(BPF_RET | BPF_K, static_cast<uint32_t>(i)));
+    }
+    code.push_back(BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, static_cast<uint32_t>(cpuOfIndex.size())));
+    code.push_back(BPF_STMT(BPF_RET | BPF_A, 0));
+
+    sock_fprog prog;
+    prog.len = static_cast<unsigned short>(code.size());
+    prog.filter = code.data();
+    if (::setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof prog) < 0)
+    {
+        LOG_ERROR("setReusePortCpuSteering sockfd:%d fail errno:%d\n", sockfd_, errno);
+        return false;
+    }
+    return true;
+}
@@ -1,25 +1,49 @@
 #pragma once
 
 #include "noncopyable.h"
+#include <vector>
 class InetAddress;
+struct SocketOptions;
 
 class Socket : noncopyable
 {
 public:
+    static const int kDefaultListenBacklog = 1024;
+
     explicit Socket(int sockfd): sockfd_(sockfd)
     {}
     
     ~Socket();
     int fd()const  {return sockfd_;}
+    // AF_INET AF_UNIX ... (SO_DOMAIN) 需要一次系统调用 只在监听socket上使用
+    int family() const;
     
     void bindAddress(const InetAddress &localaddr);
-    void listen();
+    void listen(int backlog = kDefaultListenBacklog);
     int accept(InetAddress *peeraddr);
     void shutdownWrite();
     void setTcpNoDelay(bool on); 
     void setReuseAddr(bool on);
     void setKeepAlive(bool on);
     void setReusePort(bool on);
+    void setQuickAck(bool on);
+    // 空闲idleSeconds秒后开始探测 每intervalSeconds秒一次 count次没有回应就断开
+    void setKeepAliveParams(int idleSeconds, int intervalSeconds, int count);
+    void setRecvBuffer(int bytes);
+    void setSendBuffer(int bytes);
+    void setNotSentLowat(int bytes);
+    void setUserTimeout(int milliseconds);
+    // 监听socket: 握手完成之后最多等待seconds秒 收到数据才让accept返回 0表示关闭
+    void setDeferAccept(int seconds);
+    // 监听socket: 开启TCP Fast Open queueLength是还没完成握手的TFO请求的队列长度
+    // 需要 net.ipv4.tcp_fastopen 打开服务端(0x2) 否则内核忽略
+    void setFastOpen(int queueLength);
+    // 按options设置 -1的项保持不变  family是socket的地址族 由调用者给出 避免每个连接多一次getsockopt
+    void setOptions(const SocketOptions &options, int family);
+
+    // SO_REUSEPORT组的classic BPF分发程序： 收到SYN的CPU为cpuOfIndex[i]时交给组内第i个socket
+    // 其他CPU按 cpu % 组内socket数 分发  对整个组生效 只需要在其中一个socket上设置
+    bool setReusePortCpuSteering(const std::vector<int> &cpuOfIndex);
     
 private:
     const int sockfd_;
@@ -0,0 +1,59 @@
+#pragma once
+
+/*
+已连接socket的选项 TcpServer在accept之后交给TcpConnection设置
+数值为 -1 表示不设置 使用内核默认值
+
+    defaults()   : 只打开SO_KEEPALIVE 和原来的行为一样
+    lowLatency() : 小请求/小响应的RPC  关闭Nagle， 发送队列里未发出的数据保持很少 尽早发现对端失效
+    bulk()       : 大块数据传输  较大的收发缓冲区， 保留Nagle合并小包
+*/
+struct SocketOptions
+{
+    SocketOptions()
+        : tcpNoDelay(false)
+        , quickAck(false)
+        , keepAlive(true)
+        , keepIdleSeconds(-1)
+        , keepIntervalSeconds(-1)
+        , keepCount(-1)
+        , recvBufferBytes(-1)
+        , sendBufferBytes(-1)
+        , notSentLowatBytes(-1)
+        , userTimeoutMs(-1)
+    {}
+
+    static SocketOptions defaults() { return SocketOptions(); }
+
+    static SocketOptions lowLatency()
+    {
+        SocketOptions options;
+        options.tcpNoDelay = true;
+        options.quickAck = true;
+        options.keepIdleSeconds = 30;
+        options.keepIntervalSeconds = 5;
+        options.keepCount = 3;
+        options.notSentLowatBytes = 16 * 1024;
+        options.userTimeoutMs = 30 * 1000;
+        return options;
+    }
+
+    static SocketOptions bulk()
+    {
+        SocketOptions options;
+        options.recvBufferBytes = 4 * 1024 * 1024;
+        options.sendBufferBytes = 4 * 1024 * 1024;
+        return options;
+    }
+
+    bool tcpNoDelay;            // TCP_NODELAY
+    bool quickAck;              // TCP_QUICKACK 内核在进入pingpong模式后会清掉 只影响连接刚建立的阶段
+    bool keepAlive;             // SO_KEEPALIVE
+    int keepIdleSeconds;        // TCP_KEEPIDLE
+    int keepIntervalSeconds;    // TCP_KEEPINTVL
+    int keepCount;              // TCP_KEEPCNT
+    int recvBufferBytes;        // SO_RCVBUF 设置之后内核不再自动调整接收缓冲区
+    int sendBufferBytes;        // SO_SNDBUF 设置之后内核不再自动调整发送缓冲区
+    int notSentLowatBytes;      // TCP_NOTSENT_LOWAT 未发送的数据低于该值时才报告可写
+    int userTimeoutMs;          // TCP_USER_TIMEOUT 发出的数据超过该时间没有被确认就关闭连接
+};
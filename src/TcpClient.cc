@@ -0,0 +1,105 @@
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <sys/socket.h>
+
+static EventLoop* CheckLoopNotNull(EventLoop *loop)
+{
+    if (loop == nullptr)
+    {
+        LOG_FATAL("%s:%s:%d TcpClient Loop is null! \n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    return loop;
+}
+
+TcpClient::TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg)
+    : loop_(CheckLoopNotNull(loop))
+    , connector_(new Connector(loop, serverAddr))
+    , name_(nameArg)
+    , retry_(false)
+    , connect_(false)
+    , nextConnId_(1)
+{
+    connector_->setNewConnectionCallback(std::bind(&TcpClient::newConnection, this, std::placeholders::_1));
+    LOG_DEBUG("TcpClient::TcpClient[%s] - connector %p\n", name_.c_str(), connector_.get());
+}
+
+TcpClient::~TcpClient()
+{
+    LOG_DEBUG("TcpClient::~TcpClient[%s] - connector %p\n", name_.c_str(), connector_.get());
+    TcpConnectionPtr conn = connection();
+    if (conn)
+    {
+        // removeConnection 绑定了this 换成不依赖TcpClient的回调
+        loop_->runInLoop(std::bind(&TcpConnection::detachOwner, conn));
+        conn->forceClose();
+    }
+    else
+    {
+        connector_->stop();
+    }
+}
+
+void TcpClient::connect()
+{
+    LOG_DEBUG("TcpClient::connect[%s] - connecting to %s\n",
+              name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+    connect_ = true;
+    connector_->start();
+}
+
+void TcpClient::disconnect()
+{
+    connect_ = false;
+    TcpConnectionPtr conn = connection();
+    if (conn)
+    {
+        conn->shutdown();
+    }
+}
+
+void TcpClient::stop()
+{
+    connect_ = false;
+    connector_->stop();
+}
+
+void TcpClient::newConnection(int sockfd)
+{
+    InetAddress peerAddr(InetAddress::getPeerAddr(sockfd));
+
+    char buf[64];
+    snprintf(buf, sizeof buf, ":%s#%d", peerAddr.toIpPort().c_str(), nextConnId_);
+    ++nextConnId_;
+
+    TcpConnectionPtr conn = std::make_shared<TcpConnection>(loop_, name_ + buf, sockfd, InetAddress::getLocalAddr(sockfd), peerAddr);
+    conn->setConnectionCallback(connectionCallback_);
+    conn->setMessageCallback(messageCallback_);
+    conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setSocketOptions(socketOptions_);
+    conn->setCloseCallback(std::bind(&TcpClient::removeConnection, this, std::placeholders::_1));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        connection_ = conn;
+    }
+    conn->connectEstablished();
+}
+
+void TcpClient::removeConnection(const TcpConnectionPtr &conn)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (connection_ == conn)
+        {
+            connection_.reset();
+        }
+    }
+    conn->getLoop()->queueInLoop(std::bind(&TcpConnection::connectDestoryed, conn));
+    if (retry_ && connect_)
+    {
+        LOG_DEBUG("TcpClient::removeConnection[%s] - reconnecting to %s\n",
+                  name_.c_str(), connector_->serverAddress().toIpPort().c_str());
+        connector_->restart();
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "Connector.h"
+#include "InetAddress.h"
+#include "TcpConnection.h"
+
+#include <atomic>
+#include <mutex>
+#include <string>
+
+class EventLoop;
+
+/*
+客户端 一个TcpClient管理一条到serverAddr的连接 连接和TcpServer的连接一样是TcpConnection
+所有操作都在loop线程中完成 代理可以在同一个loop上同时运行TcpServer和TcpClient 不需要额外的线程
+
+connect() 之后由Connector非阻塞地连接 失败时指数退避重试
+enableRetry() 之后连接断开会自动重新连接
+*/
+class TcpClient : noncopyable
+{
+public:
+    TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg);
+    // 析构时还有连接则直接关闭
+    ~TcpClient();
+
+    void connect();     // 可以在任意线程中调用
+    void disconnect();  // 发送完输出缓冲区之后关闭写端
+    void stop();        // 停止连接/重试 不影响已经建立的连接
+
+    TcpConnectionPtr connection() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connection_;
+    }
+
+    EventLoop* getLoop() const { return loop_; }
+    const std::string& name() const { return name_; }
+    bool retry() const { return retry_; }
+    void enableRetry() { retry_ = true; }
+    // 见Connector::setRetryDelay 在connect之前调用
+    void setRetryDelay(int initialMs, int maxMs) { connector_->setRetryDelay(initialMs, maxMs); }
+    // 连接的socket选项 默认SocketOptions::defaults()
+    void setSocketOptions(const SocketOptions &options) { socketOptions_ = options; }
+
+    // 在connect之前设置 不是线程安全的
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+    // 每次connect失败时在loop线程中调用 暂时性的错误之后Connector按退避时间重试
+    void setConnectFailedCallback(const Connector::ConnectFailedCallback &cb) { connector_->setConnectFailedCallback(cb); }
+
+private:
+    void newConnection(int sockfd);         // 在loop线程中
+    void removeConnection(const TcpConnectionPtr &conn);
+
+    EventLoop *loop_;
+    ConnectorPtr connector_;
+    const std::string name_;
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+    SocketOptions socketOptions_;
+    std::atomic_bool retry_;
+    std::atomic_bool connect_;
+    int nextConnId_;                        // 只在loop线程中使用
+    mutable std::mutex mutex_;
+    TcpConnectionPtr connection_;           // 由mutex_保护
+};
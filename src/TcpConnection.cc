@@ -3,6 +3,7 @@
 #include "Socket.h"
 #include "Channel.h"
 #include "EventLoop.h"
+#include "Clock.h"
 #include <errno.h>
 #include <memory>
 
@@ -11,12 +12,19 @@
 #include <sys/socket.h>
 #include <strings.h>
 #include <netinet/tcp.h>
+#include <sys/epoll.h>
 #include <sys/socket.h>
 
 #include <string>
+#include <algorithm>
 /*
 */
 
+// 每次readv最多读取的字节数 和Buffer::readFd栈上的extrabuf一样大
+static const size_t kMaxReadPerCall = 64 * 1024;
+
+const size_t TcpConnection::kDefaultReadBudgetBytes;
+
 static EventLoop* CheckLoopNotNull(EventLoop *loop)
 {
     if (loop == nullptr)
@@ -31,88 +39,147 @@ TcpConnection::TcpConnection(EventLoop *loop,
                 int sockfd,
                 const InetAddress& localAddr,
                 const InetAddress& peerAddr)
+                : TcpConnection(loop, 0, std::make_shared<const std::string>(nameArg), sockfd, localAddr, peerAddr)
+{
+}
+
+TcpConnection::TcpConnection(EventLoop *loop,
+                uint64_t id,
+                const std::shared_ptr<const std::string> &namePrefix,
+                int sockfd,
+                const InetAddress& localAddr,
+                const InetAddress& peerAddr)
                 : loop_(CheckLoopNotNull(loop))
-                , name_(nameArg)
+                , id_(id)
+                , namePrefix_(namePrefix)
                 , state_(kconnecting) 
                 , reading_(true)
-                , socket_(new Socket(sockfd))
-                , channel_(new Channel(loop, sockfd))
+                , socket_(sockfd)
+                , channel_(loop, sockfd)
                 , localAddr_ (localAddr)
                 , peerAddr_(peerAddr)
                 , highWaterMark_(64 * 1024 * 1024)
+                , bytesReceived_(0)
+                , bytesSent_(0)
+                , localRefs_(0)
+                , migrating_(false)
+                , hasPendingSend_(false)
+                , readBudgetBytes_(kDefaultReadBudgetBytes)
+                , readBudgetMicros_(0)
                 
 {
+    getLoop()->connectionAdded();
     // 设置Channel的回调函数 poller 给channel 通知对应事件发生， channel执行相应的回调
-    channel_->setReadCallback(
+    channel_.setReadCallback(
         std::bind(&TcpConnection::handleRead, this, std::placeholders::_1)
     );
     
-    channel_->setWriteCallback(
+    channel_.setWriteCallback(
         std::bind(&TcpConnection::handleWrite, this)
     );
     
-    channel_->setCloseCallback(
+    channel_.setCloseCallback(
         std::bind(&TcpConnection::handleClose, this)
     );
     
-    channel_->setErrorCallback(
+    channel_.setErrorCallback(
         std::bind(&TcpConnection::handleError, this)
     );
 
-    LOG_INFO("TcpConnection::ctor[%s] at fd=%d\n", name_.c_str(), sockfd);
-    socket_->setKeepAlive(true);
+    LOG_DEBUG("TcpConnection::ctor[%s] at fd=%d\n", name().c_str(), sockfd);
+    socket_.setKeepAlive(true);
                     
 }
 
 
+const std::string& TcpConnection::name() const
+{
+    std::call_once(nameOnce_, [this]() {
+        name_ = *namePrefix_;
+        if (id_ != 0)
+        {
+            name_ += std::to_string(id_);
+        }
+    });
+    return name_;
+}
+
 TcpConnection::~TcpConnection()
 {
-    LOG_INFO("TcpConnection::dtor[%s] at fd = %d state = %d\n",
-                name_.c_str(), channel_->fd(), (int)state_);
+    LOG_DEBUG("TcpConnection::dtor[%s] at fd = %d state = %d\n",
+                name().c_str(), channel_.fd(), (int)state_);
 }
 
 
 
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
-    int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
-    if (n > 0)
-    {
-        // 建立连接的用户有可读事件发生了  调用用户传入的回调操作onmessage
-        // shared_from_this 当前对象的指针指针
-        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime); 
-    }
-    else  if (n == 0)
+    // 一直读到socket读空或者用完本次事件的预算 没读空时channel标记为低优先级
+    // 剩下的数据由水平触发在下一轮报告 那时排在其他channel之后
+    const int64_t start = readBudgetMicros_ > 0 ? Clock::nowMicroSeconds() : 0;
+    size_t total = 0;
+    bool drained = false;
+    while (!drained)
     {
-        handleClose();
-    }
-    else
-    {
-        errno = savedErrno;
-        LOG_ERROR("TcpConnection heandleRead");
-        handleError();
+        size_t want = kMaxReadPerCall;
+        if (readBudgetBytes_ > 0)
+        {
+            want = std::min(want, readBudgetBytes_ - total);
+        }
+        int savedErrno = 0;
+        ssize_t n = inputBuffer_.readFd(channel_.fd(), &savedErrno, want);
+        if (n > 0)
+        {
+            total += n;
+            addBytes(&bytesReceived_, n);
+            // 流式socket 没读满说明接收缓冲区已经空了 省掉一次返回EAGAIN的read
+            drained = static_cast<size_t>(n) < want;
+            // 建立连接的用户有可读事件发生了  调用用户传入的回调操作onmessage
+            // 可读事件只会在connectEstablished之后发生 pin_一定有效
+            messageCallback_(pin_, &inputBuffer_, receiveTime); 
+            if ((readBudgetBytes_ > 0 && total >= readBudgetBytes_)
+                || (readBudgetMicros_ > 0 && Clock::nowMicroSeconds() - start >= readBudgetMicros_))
+            {
+                break;
+            }
+        }
+        else  if (n == 0)
+        {
+            handleClose();
+            return;
+        }
+        else if (total > 0 && (savedErrno == EAGAIN || savedErrno == EWOULDBLOCK))
+        {
+            drained = true;
+        }
+        else
+        {
+            errno = savedErrno;
+            LOG_ERROR("TcpConnection heandleRead");
+            handleError();
+            return;
+        }
     }
+    channel_.setLowPriority(!drained);
 }
 
 void TcpConnection::handleWrite()
 {
-    if (channel_->isWriting())
+    if (channel_.isWriting())
     {
         int savedErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
+        ssize_t n = outputBuffer_.writeFd(channel_.fd(), &savedErrno);
         if (n > 0)
         {
+            addBytes(&bytesSent_, n);
             outputBuffer_.retrieve(n);
             if(outputBuffer_.readableBytes() == 0)
             {
-                channel_->disableWriting();
+                channel_.disableWriting();
                 if (writeCompleteCallback_)
                 {
                     // 唤醒loop 对应的thread线程，执行回调函数
-                    loop_->queueInLoop(
-                        std::bind(writeCompleteCallback_, shared_from_this())
-                    );
+                    queueInOwnLoop(std::bind(writeCompleteCallback_, shared_from_this()));
                 }
                 if (state_ == kDisconnecting)
                 {
@@ -126,16 +193,16 @@ void TcpConnection::handleWrite()
         }
     }else
     {
-        LOG_ERROR("TcpConnection fd = %d is down , no more writing\n", channel_->fd());
+        LOG_ERROR("TcpConnection fd = %d is down , no more writing\n", channel_.fd());
     }
 }
 // poller ->  channel::closeCallback() => tcpConnection::handleClose
 void TcpConnection::handleClose()
 {
-    LOG_INFO("fd = %d state = %d \n", channel_->fd(),(int)state_);
+    LOG_DEBUG("fd = %d state = %d \n", channel_.fd(),(int)state_);
     setState(kDisconnected);
 
-    channel_->disableAll();
+    channel_.disableAll();
     //  tcp 关闭连接
     TcpConnectionPtr  connptr(shared_from_this());
     connectionCallback_(connptr); // 执行关闭连接的回调的
@@ -148,7 +215,7 @@ void TcpConnection::handleError()
     int optval;
     socklen_t optlen = sizeof optval;
     int err = 0;
-    if (::getsockopt(channel_->fd(), SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0)
+    if (::getsockopt(channel_.fd(), SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0)
     {
         err = errno;   
     }
@@ -156,7 +223,7 @@ void TcpConnection::handleError()
     {
         err = optval;
     }
-    LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d \n",name_.c_str(), err);
+    LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d \n",name().c_str(), err);
 }
 
 
@@ -165,23 +232,49 @@ void TcpConnection:: send(const std::string &buf)
 {
     if (state_ == kConnected)
     {
-        //在当前的loop是否在对应的线程中
-        if (loop_->isInLoopThread())
+        //在当前的loop是否在对应的线程中 前面还有没发出的数据时排在它们后面
+        EventLoop *loop = getLoop();
+        if (loop->isInLoopThread() && !migrating_ && !hasPendingSend_.load(std::memory_order_acquire))
         {
             sendInLoop(buf.c_str(), buf.size());
+            return;
+        }
+        // 跨线程时buf可能在执行之前就失效了 拷贝一份
+        bool schedule = false;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex_);
+            schedule = pendingSend_.empty();
+            pendingSend_.append(buf);
+            hasPendingSend_.store(true, std::memory_order_release);
         }
-        else 
+        // 已经有flushPendingSend在排队时 它会把这次的数据一起发出
+        if (schedule)
         {
-            loop_->runInLoop(std::bind(
-                &TcpConnection::sendInLoop,
-                this,
-                buf.c_str(),
-                buf.size()
-            ));
+            loop->queueInLoop(std::bind(&TcpConnection::flushPendingSend, shared_from_this()));
         }
     }
 }
 
+void TcpConnection::flushPendingSend()
+{
+    EventLoop *loop = getLoop();
+    if (!loop->isInLoopThread() || migrating_)
+    {
+        loop->queueInLoop(std::bind(&TcpConnection::flushPendingSend, shared_from_this()));
+        return;
+    }
+    std::string message;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex_);
+        message.swap(pendingSend_);
+        hasPendingSend_.store(false, std::memory_order_release);
+    }
+    if (!message.empty())
+    {
+        sendInLoop(message.data(), message.size());
+    }
+}
+
 // 发送数据， 应用的写速度快， 而内核发送数据慢， 需要把发送的数据写入缓冲区 并且设置了 水位回调函数
 void TcpConnection::sendInLoop(const void* data, size_t len)
 {
@@ -190,25 +283,24 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
     bool faultError = false;
 
     // 之前调用过connection的shutdown 则不能发送
-    if (state_ = kDisconnected)
+    if (state_ == kDisconnected)
     {
         LOG_ERROR("disconnected, give up  writing\n");
         return ;
     }
     
     // 表示channel第一次开始写数据， 并且缓冲区没有待发送数据
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    if (!channel_.isWriting() && outputBuffer_.readableBytes() == 0)
     {
-        nwrote =  ::write(channel_->fd(), data, len);
+        nwrote =  ::write(channel_.fd(), data, len);
         if (nwrote > 0)
         {
+            addBytes(&bytesSent_, nwrote);
             remaining = len - nwrote;
             if (remaining == 0 && writeCompleteCallback_)
             {
                 // 数据一次性发送完成 就不用给channel设置epollout事件
-                loop_->queueInLoop(
-                    std::bind(writeCompleteCallback_, shared_from_this())
-                );
+                queueInOwnLoop(std::bind(writeCompleteCallback_, shared_from_this()));
             }
         }
         else
@@ -240,15 +332,13 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
             && oldLen < highWaterMark_
             && highWaterMarkCallback_)
         {
-            loop_->queueInLoop(
-                std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining)
-            );
+            queueInOwnLoop(std::bind(highWaterMarkCallback_, shared_from_this(), oldLen + remaining));
         }
         outputBuffer_.append((char*)data + nwrote, remaining);
-        if (!channel_->isWriting())
+        if (!channel_.isWriting())
         {
             //注册channel的写事件，否则poller不会给channel通知epollout
-            channel_->enableWriting();
+            channel_.enableWriting();
         }
     }
 }
@@ -258,13 +348,23 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
 void TcpConnection::connectEstablished()
 {
     setState(kConnected);
-    // 强智能指针保证TcpConnection不被释放,
-    channel_->tie(shared_from_this()); 
+    // TcpConnection是在baseLoop线程中创建的， 绑定了NUMA节点的subLoop在自己的线程中重新分配读写缓冲区
+    // 这样缓冲区的内存落在subLoop所在的节点上
+    if (getLoop()->numaNode() >= 0)
+    {
+        Buffer input;
+        inputBuffer_.swap(input);
+        Buffer output;
+        outputBuffer_.swap(output);
+    }
+    // 强智能指针保证TcpConnection不被释放, connectDestoryed时释放
+    pin_ = shared_from_this();
+    getLoop()->pinConnection(this);
     // 向poller注册channel的epollin事件 也就是读事件
-    channel_->enableReading();
+    channel_.enableReading();
 
     // 新连接建立 执行回调函数
-    connectionCallback_(shared_from_this());
+    connectionCallback_(pin_);
 }
 // 连接销毁 关闭 
 void TcpConnection::connectDestoryed()
@@ -273,28 +373,203 @@ void TcpConnection::connectDestoryed()
     {
         setState(kDisconnected);
         // 取消监听所有的事件 从poller 中删除
-        channel_->disableAll();
+        channel_.disableAll();
     }
     
     // 把channel从poller 中删除掉
-    channel_->remove();
+    channel_.remove();
+    getLoop()->unpinConnection(this);
+    getLoop()->connectionRemoved();
+    // 调用方的functor还持有一份 这里不会析构
+    pin_.reset();
+}
+
+void TcpConnection::detachOwner()
+{
+    closeCallback_ = [](const TcpConnectionPtr &conn) {
+        conn->getLoop()->queueInLoop(std::bind(&TcpConnection::connectDestoryed, conn));
+    };
+    migrateCallback_ = MigrateCallback();
+}
+
+TcpConnectionHandle TcpConnection::handle()
+{
+    return TcpConnectionHandle(this);
+}
+
+void TcpConnection::acquireLocal()
+{
+    if (localRefs_++ == 0)
+    {
+        if (!getLoop()->isInLoopThread())
+        {
+            LOG_FATAL("TcpConnectionHandle [%s] used outside its loop thread\n", name().c_str());
+        }
+        localPin_ = shared_from_this();
+    }
+}
+
+void TcpConnection::releaseLocal()
+{
+    if (--localRefs_ == 0)
+    {
+        // 可能是最后一个引用 先移出来 函数返回时才析构
+        TcpConnectionPtr last;
+        last.swap(localPin_);
+    }
 }
 
 void TcpConnection::shutdown()
 {
-    if (state_ == kDisconnected)
+    if (state_ == kConnected)
+    {
+        setState(kDisconnecting);
+        getLoop()->runInLoop(
+            std::bind(&TcpConnection::shutdownInLoop, shared_from_this())
+        );
+    }
+}
+
+void TcpConnection::forceClose()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
     {
         setState(kDisconnecting);
-        loop_->runInLoop(
-            std::bind(&TcpConnection::shutdownInLoop, this)
+        getLoop()->queueInLoop(
+            std::bind(&TcpConnection::forceCloseInLoop, shared_from_this())
         );
     }
 }
 
+void TcpConnection::forceCloseInLoop()
+{
+    EventLoop *loop = getLoop();
+    if (!loop->isInLoopThread())
+    {
+        loop->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+        return;
+    }
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        handleClose();
+    }
+}
+
 void TcpConnection::shutdownInLoop()
 {
-    if (!channel_->isWriting()) // 说明当前outputbuffer 中的数据已经穿发送完成
+    EventLoop *loop = getLoop();
+    // 迁移期间channel的事件被清掉了 isWriting不可信 等migrateEstablished之后再判断
+    if (!loop->isInLoopThread() || migrating_)
+    {
+        loop->queueInLoop(std::bind(&TcpConnection::shutdownInLoop, shared_from_this()));
+        return;
+    }
+    // shutdown之前send的数据可能还在pendingSend_里
+    if (hasPendingSend_.load(std::memory_order_acquire))
+    {
+        flushPendingSend();
+    }
+    if (!channel_.isWriting()) // 说明当前outputbuffer 中的数据已经穿发送完成
     {
-        socket_->shutdownWrite();
+        socket_.shutdownWrite();
     } 
-}
\ No newline at end of file
+}
+
+void TcpConnection::migrateTo(EventLoop *target)
+{
+    if (target == nullptr)
+    {
+        return;
+    }
+    // 现在就计入target 迁移执行之前target的连接数不会降为0 不会被退役回收
+    target->connectionAdded();
+    // 总是放到pending functors中执行 这时不在Channel::handleEvent的调用栈里
+    getLoop()->queueInLoop(
+        std::bind(&TcpConnection::migrateInLoop, shared_from_this(), target)
+    );
+}
+
+void TcpConnection::migrateInLoop(EventLoop *target)
+{
+    EventLoop *loop = getLoop();
+    // 排队期间连接已经迁移过了 到现在的loop中执行
+    if (!loop->isInLoopThread())
+    {
+        loop->queueInLoop(std::bind(&TcpConnection::migrateInLoop, shared_from_this(), target));
+        return;
+    }
+    // 上一次迁移发布了loop_ 但migrateEstablished还没有执行 channel的事件还没有恢复
+    // 排到它后面再迁移 否则带走的events是空的 连接不再读写
+    if (migrating_)
+    {
+        loop->queueInLoop(std::bind(&TcpConnection::migrateInLoop, shared_from_this(), target));
+        return;
+    }
+    // 连接已经关闭 或者句柄还在使用(句柄是loop内的非原子计数 不能跟着连接到其他线程)
+    if (state_ != kConnected || target == loop || localRefs_ > 0)
+    {
+        if (localRefs_ > 0)
+        {
+            LOG_ERROR("TcpConnection::migrate [%s] has %d local handles, not migrated\n", name().c_str(), localRefs_);
+        }
+        // 放弃迁移 在target线程中撤销migrateTo时的计数 连接数降为0时drainedCallback要在target线程中执行
+        target->queueInLoop(std::bind(&EventLoop::connectionRemoved, target));
+        return;
+    }
+    int events = channel_.events();
+    channel_.disableAll();
+    channel_.remove();
+    channel_.setOwnerLoop(target);
+    migrating_ = true;
+    if (migrateCallback_)
+    {
+        migrateCallback_(shared_from_this(), loop, target);
+    }
+    // target的计数在migrateTo时已经加上 这里从原来的loop减掉 退役中的loop在这里可能降为0并被回收
+    loop->unpinConnection(this);
+    loop_.store(target, std::memory_order_release);
+    loop->connectionRemoved();
+    LOG_DEBUG("TcpConnection::migrate [%s] fd=%d %p -> %p\n", name().c_str(), channel_.fd(), loop, target);
+    target->queueInLoop(
+        std::bind(&TcpConnection::migrateEstablished, shared_from_this(), events)
+    );
+}
+
+void TcpConnection::queueInOwnLoop(const Functor &cb)
+{
+    getLoop()->queueInLoop(std::bind(&TcpConnection::runInOwnLoop, shared_from_this(), cb));
+}
+
+void TcpConnection::runInOwnLoop(const Functor &cb)
+{
+    EventLoop *loop = getLoop();
+    if (!loop->isInLoopThread())
+    {
+        loop->queueInLoop(std::bind(&TcpConnection::runInOwnLoop, shared_from_this(), cb));
+        return;
+    }
+    cb();
+}
+
+void TcpConnection::migrateEstablished(int events)
+{
+    migrating_ = false;
+    // 迁移期间已经connectDestoryed的连接不再登记
+    if (pin_)
+    {
+        getLoop()->pinConnection(this);
+    }
+    if (state_ == kDisconnected)
+    {
+        return;
+    }
+    // 迁移期间到达的数据在内核缓冲区中 重新注册之后poller马上会报告可读
+    if (events & (EPOLLIN | EPOLLPRI))
+    {
+        channel_.enableReading();
+    }
+    if (events & EPOLLOUT)
+    {
+        channel_.enableWriting();
+    }
+}
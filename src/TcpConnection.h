@@ -5,13 +5,18 @@
 #include "Buffer.h"
 #include "Timestamp.h"
 #include "Callbacks.h"
+#include "Socket.h"
+#include "Channel.h"
+#include "SocketOptions.h"
 #include <string>
 #include <atomic>
+#include <mutex>
 
 class Channel;
 class EventLoop;
 class Socket;
 class EventLoop;
+class TcpConnectionHandle;
 /*
 user -> tcpserver -> tcpconnection
 
@@ -30,23 +35,60 @@ public:
                 int sockfd,
                 const InetAddress& localAddr_,
                 const InetAddress& peerAddr_);
+    // TcpServer使用 名字在第一次调用name()时才格式化为 namePrefix + id
+    TcpConnection(EventLoop *loop,
+                uint64_t id,
+                const std::shared_ptr<const std::string> &namePrefix,
+                int sockfd,
+                const InetAddress& localAddr_,
+                const InetAddress& peerAddr_);
     ~TcpConnection();  
 
-    EventLoop* getLoop() const {return loop_;}
+    // 迁移之后会变化 可以在任意线程中读取
+    EventLoop* getLoop() const {return loop_.load(std::memory_order_acquire);}
+    // TcpServer内唯一的连接ID 使用名字构造时为0
+    uint64_t id() const { return id_; }
     // 这个name 是干什么的啊？
-    const std::string& name() const { return name_;}
+    const std::string& name() const;
     const InetAddress& localAddress() const { return localAddr_; }
     const InetAddress& peerAddress() const { return peerAddr_; }
 
     bool connected() const {return state_ == kConnected; }
     
+    // 可以在任意线程中调用 同一个线程的多次send按调用顺序发出 迁移期间也一样
     void send(const std::string &buf);
     void shutdown();
+    // 不等待输出缓冲区发完 直接关闭连接 可以在任意线程中调用
+    void forceClose();
+
+    // 把连接迁移到target 可以在任意线程中调用 调用时target必须还没有被回收
+    // 调用时就计入target的连接数 迁移完成或者放弃之前target不会因为连接数为0被回收
+    // 在原来的loop中把channel从poller删除， 再到target中重新注册原来的事件
+    // 迁移期间到达的数据留在内核的socket缓冲区里 读写buffer和回调都跟着TcpConnection对象走 不会丢数据
+    void migrateTo(EventLoop *target);
+
+    // 每次可读事件的读预算 超出之后停止读取， 下一轮loop中排在其他连接之后
+    // bytes 为0表示不限字节数 一直读到EAGAIN； micros 为0表示不限时间 (时间包含messageCallback)
+    static const size_t kDefaultReadBudgetBytes = 64 * 1024;
+    void setReadBudget(size_t bytes, int64_t micros) { readBudgetBytes_ = bytes; readBudgetMicros_ = micros; }
+
+    // 设置socket选项 TcpServer在accept之后、connectEstablished之前调用
+    void setSocketOptions(const SocketOptions &options) { socket_.setOptions(options, localAddr_.family()); }
+
+    // 在连接所在的loop线程中调用 返回loop内使用的句柄 见TcpConnectionHandle
+    TcpConnectionHandle handle();
+
+    // 收发的字节数 由连接所在的loop线程更新 TcpServer::rebalance在baseLoop中读取
+    uint64_t bytesReceived() const { return bytesReceived_.load(std::memory_order_relaxed); }
+    uint64_t bytesSent() const { return bytesSent_.load(std::memory_order_relaxed); }
 
     void setConnectionCallback(const ConnectionCallback& cb) { connectionCallback_ = cb; }
     void setMessageCallback(const MessageCallback& cb) { messageCallback_ = cb; }
     void setWriteCompleteCallback(const WriteCompleteCallback& cb) { writeCompleteCallback_ = cb; }
     void setCloseCallback(const CloseCallback& cb) { closeCallback_ = cb; }
+    void setMigrateCallback(const MigrateCallback& cb) { migrateCallback_ = cb; }
+    // 拥有者(TcpServer/TcpClient)析构时在连接所在的loop线程中调用 之后关闭时只销毁连接 不再回调拥有者
+    void detachOwner();
 
     void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark)
     { 
@@ -59,6 +101,11 @@ public:
     void connectDestoryed();
     
 private:
+    friend class TcpConnectionHandle;
+    // 本loop内的句柄计数 不是原子的 只在0和1之间变化时才持有/释放localPin_
+    void acquireLocal();
+    void releaseLocal();
+
     enum StateE {kDisconnected, kconnecting, kConnected, kDisconnecting};
     void setState(StateE state) { state_ = state; }
     void handleRead(Timestamp receiveTime); 
@@ -68,19 +115,37 @@ private:
     
     
     void sendInLoop(const void *message, size_t len); 
+    // 把pendingSend_交给sendInLoop 连接迁移走了就转到新的loop 迁移还没完成就排到migrateEstablished后面
+    void flushPendingSend();
     void shutdownInLoop(); 
+    void forceCloseInLoop();
+    void migrateInLoop(EventLoop *target);
+    void migrateEstablished(int events);
+    // 投递到连接所在的loop 执行时连接已经迁移走了就转到新的loop 回调不会在原来的线程中执行
+    using Functor = std::function<void()>;
+    void queueInOwnLoop(const Functor &cb);
+    void runInOwnLoop(const Functor &cb);
+    // 单线程写入 不需要原子的加法
+    void addBytes(std::atomic<uint64_t> *counter, size_t n)
+    {
+        counter->store(counter->load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
    
     
     // 这里不是baseLoop， TcpConnection都是在subLoop中管理的
-    EventLoop *loop_;
-    const std::string name_;
+    std::atomic<EventLoop*> loop_;
+    const uint64_t id_;
+    std::shared_ptr<const std::string> namePrefix_;
+    mutable std::once_flag nameOnce_;
+    mutable std::string name_;
     std::atomic_int state_;
     bool reading_;
     
     // 这里和acceptor类似 Acceptor -》 mainLoop 主要监听新用户的连接
     // TcpConnection => subLoop 监听已连接用户的读写事件
-    std::unique_ptr<Socket> socket_;
-    std::unique_ptr<Channel> channel_;
+    // 直接作为成员 和TcpConnection在同一次分配中
+    Socket socket_;
+    Channel channel_;
     
     
     const InetAddress localAddr_;
@@ -94,10 +159,82 @@ private:
     WriteCompleteCallback writeCompleteCallback_;
     HighWaterMarkCallback highWaterMarkCallback_;
     CloseCallback closeCallback_;
+    MigrateCallback migrateCallback_;
     
     size_t highWaterMark_;
     
     // 读写buffer
     Buffer inputBuffer_;
     Buffer outputBuffer_; 
-};
\ No newline at end of file
+
+    std::atomic<uint64_t> bytesReceived_;
+    std::atomic<uint64_t> bytesSent_;
+
+    // connectEstablished到connectDestoryed之间持有自己 channel在poller中时对象一定存在
+    // 所以Channel不需要tie 每次事件不再weak_ptr::lock  回调直接传pin_的引用 不再拷贝shared_ptr
+    TcpConnectionPtr pin_;
+    int localRefs_;
+    // migrateInLoop到migrateEstablished之间为true 只在连接所在的loop线程中读写
+    bool migrating_;
+    // 跨线程和迁移期间的send先按顺序追加到这里 由flushPendingSend在连接所在的loop中发出
+    // 不再每次send投递一个functor 迁移时也不会有发送留在原来loop的队列里被后来的发送超过
+    std::mutex pendingMutex_;
+    std::string pendingSend_;
+    std::atomic_bool hasPendingSend_;
+    TcpConnectionPtr localPin_;
+    size_t readBudgetBytes_;
+    int64_t readBudgetMicros_;
+};
+
+/*
+loop内使用的连接句柄 侵入式计数
+在连接所在的loop线程中拷贝和析构都只修改TcpConnection中的普通int， 没有原子操作
+计数从0变为1时才拷贝一次shared_ptr， 降为0时释放
+需要交给其他线程时调用share()转换成TcpConnectionPtr
+有句柄存在的连接不能迁移到其他loop
+*/
+class TcpConnectionHandle
+{
+public:
+    TcpConnectionHandle() : conn_(nullptr) {}
+    explicit TcpConnectionHandle(TcpConnection *conn)
+        : conn_(conn)
+    {
+        if (conn_ != nullptr)
+        {
+            conn_->acquireLocal();
+        }
+    }
+    TcpConnectionHandle(const TcpConnectionHandle &rhs)
+        : TcpConnectionHandle(rhs.conn_)
+    {}
+    TcpConnectionHandle(TcpConnectionHandle &&rhs)
+        : conn_(rhs.conn_)
+    {
+        rhs.conn_ = nullptr;
+    }
+    ~TcpConnectionHandle()
+    {
+        if (conn_ != nullptr)
+        {
+            conn_->releaseLocal();
+        }
+    }
+    TcpConnectionHandle& operator=(TcpConnectionHandle rhs)
+    {
+        std::swap(conn_, rhs.conn_);
+        return *this;
+    }
+
+    TcpConnection* get() const { return conn_; }
+    TcpConnection* operator->() const { return conn_; }
+    explicit operator bool() const { return conn_ != nullptr; }
+
+    TcpConnectionPtr share() const
+    {
+        return conn_ != nullptr ? conn_->shared_from_this() : TcpConnectionPtr();
+    }
+
+private:
+    TcpConnection *conn_;
+};
@@ -2,9 +2,13 @@
 #include "Logger.h"
 #include "Acceptor.h"
 #include "TcpConnection.h"
+#include "PoolAllocator.h"
+#include "Clock.h"
 
 #include <strings.h>
+#include <unistd.h>
 #include <functional>
+#include <algorithm>
 
 EventLoop* CheckLoopNotNull(EventLoop *loop)
 {
@@ -16,36 +20,137 @@ EventLoop* CheckLoopNotNull(EventLoop *loop)
 }
 
 
+// 继承来的监听socket绑定的地址
+static InetAddress localAddressOf(const std::vector<int> &listenFds)
+{
+    sockaddr_storage local;
+    ::bzero(&local, sizeof local);
+    socklen_t addrlen = sizeof local;
+    if (listenFds.empty() || ::getsockname(listenFds.front(), (sockaddr*)&local, &addrlen) < 0)
+    {
+        LOG_FATAL("%s:%s:%d invalid inherited listen socket \n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    return InetAddress((sockaddr*)&local, addrlen);
+}
+
+// 一个Unix域的path只能bind一次 SO_REUSEPORT不起作用 只能由一个Acceptor分发连接
+static TcpServer::Option optionFor(const InetAddress &listenAddr, TcpServer::Option option)
+{
+    if (listenAddr.isUnix() && option != TcpServer::kNoReusePort)
+    {
+        LOG_INFO("TcpServer %s - SO_REUSEPORT is not supported, using a single acceptor\n",
+                 listenAddr.toIpPort().c_str());
+        return TcpServer::kNoReusePort;
+    }
+    return option;
+}
+
 TcpServer::TcpServer(EventLoop *loop,
                     const InetAddress &listenAddr,
                     const std::string &nameArg,
                     Option option)
+                    : TcpServer(loop, listenAddr, nameArg, option, std::vector<int>())
+{
+}
+
+TcpServer::TcpServer(EventLoop *loop,
+                    const std::vector<int> &listenFds,
+                    const std::string &nameArg,
+                    Option option)
+                    : TcpServer(loop, localAddressOf(listenFds), nameArg, option, listenFds)
+{
+}
+
+TcpServer::TcpServer(EventLoop *loop,
+                    const InetAddress &listenAddr,
+                    const std::string &nameArg,
+                    Option option,
+                    const std::vector<int> &listenFds)
                     : loop_(CheckLoopNotNull(loop))
                     , ipPort_(listenAddr.toIpPort())
                     , name_(nameArg)
-                    , acceptor_(new Acceptor(loop, listenAddr, option == kReusePort))
+                    , listenAddr_(listenAddr)
+                    , option_(optionFor(listenAddr, option))
+                    , acceptor_(option_ == kReusePortPerLoop ? nullptr
+                                : listenFds.empty() ? new Acceptor(loop, listenAddr, option_ == kReusePort)
+                                : new Acceptor(loop, listenFds.front()))
                     , threadPool_(new EventLoopThreadPool(loop,  name_))
+                    , inheritedGroup_(option_ == kReusePortPerLoop && !listenFds.empty())
                     , connectionCallback_()
                     , messageCallback_()
-                    , nextConnId_(1)
+                    , maxAcceptsPerEvent_(0)
+                    , listenBacklog_(Socket::kDefaultListenBacklog)
+                    , deferAcceptSeconds_(0)
+                    , fastOpenQueueLength_(0)
+                    , readBudgetBytes_(TcpConnection::kDefaultReadBudgetBytes)
+                    , readBudgetMicros_(0)
+                    , cpuSteering_(false)
                     , started_(0)
+                    , maxConnections_(0)
+                    , numConnections_(0)
+                    , nextConnId_(1)
+                    , connNamePrefix_(std::make_shared<const std::string>(name_ + "-" + ipPort_ + "#"))
 {
-    acceptor_->setNewConncetionCallback(std::bind(&TcpServer::newConncetion, 
-    this, std::placeholders::_1,  std::placeholders::_2));
+    if (option_ == kReusePortPerLoop)
+    {
+        inheritedFds_ = listenFds;
+    }
+    else
+    {
+        for (size_t i = 1; i < listenFds.size(); ++i)
+        {
+            LOG_ERROR("TcpServer [%s] - only one listen socket is used, closing fd=%d\n", name_.c_str(), listenFds[i]);
+            ::close(listenFds[i]);
+        }
+    }
+    if (acceptor_)
+    {
+        acceptor_->setNewConnectionBatchCallback(std::bind(&TcpServer::newConncetion, 
+        this, std::placeholders::_1));
+        acceptor_->setFdExhaustedCallback(std::bind(&TcpServer::shedConnection,
+        this, kFdExhausted, std::placeholders::_1));
+    }
+    threadPool_->setLoopReapedCallback(std::bind(&TcpServer::removeShard, this, std::placeholders::_1));
 }
 
 TcpServer::~TcpServer()
 {
-    
-    for (auto& item : conncetions_)
+    // Acceptor的Channel要在所属loop的线程中从poller删除 等待删除完成之后再继续
+    for (std::unique_ptr<Acceptor> &acceptor : loopAcceptors_)
     {
-        // 局部强智能智能出作用域 可以自动释放TcpConnectionPtr 资源
-        TcpConnectionPtr conn(item.second);
-        item.second.reset();
-        // 销毁连接
-        conn->getLoop()->runInLoop(
-            std::bind(&TcpConnection::connectDestoryed, conn)
-        );   
+        Acceptor *raw = acceptor.release();
+        raw->getLoop()->runInLoopAndWait([raw]() { delete raw; });
+    }
+    loopAcceptors_.clear();
+    for (int fd : inheritedFds_)
+    {
+        ::close(fd);
+    }
+
+    std::unordered_map<EventLoop*, std::unique_ptr<ConnectionShard>> shards;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shards.swap(shards_);
+    }
+    // 每个loop上在一个functor里完成 期间这个loop上的连接不会关闭或者迁移 分片一直找得到
+    // 等它执行完 之后不会再有连接回调到这个TcpServer
+    for (auto &shard : shards)
+    {
+        EventLoop *ioLoop = shard.first;
+        ConnectionShard *connections = shard.second.get();
+        ioLoop->runInLoopAndWait([this, ioLoop, connections]() {
+            std::lock_guard<std::mutex> lock(connections->mutex);
+            for (auto &item : connections->connections)
+            {
+                const TcpConnectionPtr &conn = item.second;
+                conn->detachOwner();
+                // 销毁连接
+                ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestoryed, conn));
+            }
+            connections->connections.clear();
+            // loop可能比TcpServer活得久 最后去掉loop上以this为key的分片指针
+            ioLoop->setLoopLocal(this, nullptr);
+        });
     }
 }
 
@@ -55,6 +160,203 @@ void TcpServer::setThreadNum(int numThreads)
     threadPool_->setThreadNum(numThreads);
 }
 
+void TcpServer::setThreadPlacement(EventLoopThreadPool::Placement placement,
+                                const std::vector<int> &cpus)
+{
+    threadPool_->setPlacement(placement, cpus);
+}
+
+void TcpServer::setLoopSelection(EventLoopThreadPool::Selection selection)
+{
+    threadPool_->setSelection(selection);
+}
+
+void TcpServer::setLoopSelector(const EventLoopThreadPool::LoopSelector &selector)
+{
+    threadPool_->setLoopSelector(selector);
+}
+
+void TcpServer::setPrewarm(int expectedChannels)
+{
+    threadPool_->setPrewarm(expectedChannels);
+}
+
+void TcpServer::rebalance(double imbalance, int maxMoves)
+{
+    loop_->runInLoop(std::bind(&TcpServer::rebalanceInLoop, this, imbalance, maxMoves));
+}
+
+void TcpServer::rebalanceInLoop(double imbalance, int maxMoves)
+{
+    std::vector<TcpConnectionPtr> conns = allConnections();
+
+    std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+    if (loops.size() < 2 && threadPool_->retiringLoops() == 0)
+    {
+        return;
+    }
+    std::unordered_map<EventLoop*, uint64_t> loads;
+    for (EventLoop *ioLoop : loops)
+    {
+        loads[ioLoop] = 0;
+    }
+
+    // 每个连接本次的字节数 顺便重建快照 已经关闭的连接不再保留
+    std::unordered_map<uint64_t, uint64_t> snapshot;
+    std::vector<std::pair<uint64_t, TcpConnectionPtr>> heat;
+    std::vector<TcpConnectionPtr> orphans;      // 在退役中的loop上
+    for (const TcpConnectionPtr &conn : conns)
+    {
+        uint64_t bytes = conn->bytesReceived() + conn->bytesSent();
+        auto last = rebalanceBytes_.find(conn->id());
+        uint64_t delta = last == rebalanceBytes_.end() ? bytes : bytes - last->second;
+        snapshot[conn->id()] = bytes;
+
+        auto load = loads.find(conn->getLoop());
+        if (load == loads.end())
+        {
+            orphans.push_back(conn);
+            continue;
+        }
+        load->second += delta;
+        heat.emplace_back(delta, conn);
+    }
+    rebalanceBytes_.swap(snapshot);
+
+    auto coolest = [&loads]() {
+        auto it = std::min_element(loads.begin(), loads.end(),
+            [](const std::pair<EventLoop* const, uint64_t> &a, const std::pair<EventLoop* const, uint64_t> &b) {
+                return a.second < b.second;
+            });
+        return it->first;
+    };
+    for (const TcpConnectionPtr &conn : orphans)
+    {
+        conn->migrateTo(coolest());
+    }
+
+    // 从最热的连接开始 只有迁移之后两个loop的差距变小才迁移
+    std::sort(heat.begin(), heat.end(),
+        [](const std::pair<uint64_t, TcpConnectionPtr> &a, const std::pair<uint64_t, TcpConnectionPtr> &b) {
+            return a.first > b.first;
+        });
+    uint64_t total = 0;
+    for (auto &item : loads)
+    {
+        total += item.second;
+    }
+    double average = static_cast<double>(total) / loads.size();
+    int moves = 0;
+    for (auto &item : heat)
+    {
+        if (moves >= maxMoves || total == 0)
+        {
+            break;
+        }
+        EventLoop *from = item.second->getLoop();
+        EventLoop *to = coolest();
+        uint64_t delta = item.first;
+        if (from == to || loads[from] <= average * imbalance || delta == 0 || delta >= loads[from] - loads[to])
+        {
+            continue;
+        }
+        LOG_INFO("TcpServer::rebalance [%s] - move %s (%lu bytes) %p -> %p\n",
+                name_.c_str(), item.second->name().c_str(), static_cast<unsigned long>(delta), from, to);
+        item.second->migrateTo(to);
+        loads[from] -= delta;
+        loads[to] += delta;
+        ++moves;
+    }
+}
+
+void TcpServer::setCpuSteering(bool on)
+{
+    cpuSteering_ = on;
+    if (acceptor_)
+    {
+        acceptor_->setReadIncomingCpu(on);
+    }
+}
+
+void TcpServer::setMaxAcceptsPerEvent(int n)
+{
+    maxAcceptsPerEvent_ = n;
+    if (acceptor_)
+    {
+        acceptor_->setMaxAcceptsPerEvent(n);
+    }
+}
+
+void TcpServer::setListenBacklog(int backlog)
+{
+    listenBacklog_ = backlog;
+    if (acceptor_)
+    {
+        acceptor_->setBacklog(backlog);
+    }
+}
+
+void TcpServer::setDeferAccept(int seconds)
+{
+    deferAcceptSeconds_ = seconds;
+    if (acceptor_)
+    {
+        acceptor_->setDeferAccept(seconds);
+    }
+}
+
+void TcpServer::setFastOpen(int queueLength)
+{
+    fastOpenQueueLength_ = queueLength;
+    if (acceptor_)
+    {
+        acceptor_->setFastOpen(queueLength);
+    }
+}
+
+void TcpServer::setAcceptRate(double rate, double burst)
+{
+    if (rate > 0)
+    {
+        acceptRate_.reset(new TokenBucket(rate, burst));
+    }
+    else
+    {
+        acceptRate_.reset();
+    }
+}
+
+bool TcpServer::admitConnection(int sockfd, const InetAddress &peerAddr)
+{
+    ShedReason reason;
+    if (acceptRate_ && !acceptRate_->tryTake(Clock::cachedNow()))
+    {
+        reason = kRateLimited;
+    }
+    else if (numConnections_.fetch_add(1, std::memory_order_relaxed) < maxConnections_ || maxConnections_ <= 0)
+    {
+        return true;
+    }
+    else
+    {
+        numConnections_.fetch_sub(1, std::memory_order_relaxed);
+        reason = kTooManyConnections;
+    }
+    ::close(sockfd);
+    shedConnection(reason, peerAddr);
+    return false;
+}
+
+void TcpServer::shedConnection(ShedReason reason, const InetAddress &peerAddr)
+{
+    LOG_DEBUG("TcpServer::shedConnection [%s] - %s reason=%d\n",
+            name_.c_str(), peerAddr.toIpPort().c_str(), static_cast<int>(reason));
+    if (shedCallback_)
+    {
+        shedCallback_(reason, peerAddr);
+    }
+}
+
 // run in loop 
 void TcpServer::start()
 {
@@ -62,43 +364,250 @@ void TcpServer::start()
     {
         // 启动底层的loop线程池 
         threadPool_->start(threadInitCallback_); 
-        loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+        // 分片指针在连接登记之前投递到各个loop
+        for (EventLoop *ioLoop : threadPool_->getAllLoops())
+        {
+            addShard(ioLoop);
+        }
+        if (option_ != kReusePortPerLoop)
+        {
+            loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
+            return;
+        }
+        // 没有subloop时只有baseLoop一个Acceptor
+        std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+        for (EventLoop *ioLoop : loops)
+        {
+            startLoopAcceptor(ioLoop);
+        }
+        // 继承来的socket比loop多 其余的也要accept 否则它们队列里的连接得不到处理
+        for (size_t i = 0; !inheritedFds_.empty(); ++i)
+        {
+            startLoopAcceptor(loops[i % loops.size()]);
+        }
+        updateCpuSteering();
+    }
+}
+
+std::vector<int> TcpServer::listenFds() const
+{
+    std::vector<int> fds;
+    if (acceptor_)
+    {
+        fds.push_back(acceptor_->fd());
+    }
+    for (const std::unique_ptr<Acceptor> &acceptor : loopAcceptors_)
+    {
+        fds.push_back(acceptor->fd());
+    }
+    return fds;
+}
+
+void TcpServer::stopAccepting()
+{
+    loop_->runInLoop([this]() {
+        if (acceptor_)
+        {
+            acceptor_->stopListening();
+        }
+        // loopAcceptors_只在baseLoop中修改 删除也是投递到各自的loop 排在stopListening之后
+        for (std::unique_ptr<Acceptor> &acceptor : loopAcceptors_)
+        {
+            acceptor->getLoop()->runInLoop(std::bind(&Acceptor::stopListening, acceptor.get()));
+        }
+    });
+}
+
+// 组内socket的下标就是listen的顺序 startLoopAcceptor保证它就是loopAcceptors_的顺序
+// 内核删除组内的socket时把最后一个移到空出来的位置 retireThreadInLoop中同样处理loopAcceptors_
+void TcpServer::updateCpuSteering()
+{
+    if (!cpuSteering_ || loopAcceptors_.empty())
+    {
+        return;
+    }
+    if (inheritedGroup_)
+    {
+        LOG_INFO("TcpServer [%s] - listen sockets are inherited, cpu steering skipped\n", name_.c_str());
+        return;
+    }
+    std::vector<int> cpuOfIndex;
+    for (std::unique_ptr<Acceptor> &acceptor : loopAcceptors_)
+    {
+        cpuOfIndex.push_back(acceptor->getLoop()->cpu());
+    }
+    loopAcceptors_.front()->setCpuSteering(cpuOfIndex);
+}
+
+void TcpServer::startLoopAcceptor(EventLoop *ioLoop)
+{
+    Acceptor *acceptor = nullptr;
+    if (!inheritedFds_.empty())
+    {
+        acceptor = new Acceptor(ioLoop, inheritedFds_.front());
+        inheritedFds_.erase(inheritedFds_.begin());
+    }
+    else
+    {
+        acceptor = new Acceptor(ioLoop, listenAddr_, true);
+    }
+    acceptor->setNewConncetionCallback(std::bind(&TcpServer::establishConnection,
+        this, ioLoop, std::placeholders::_1, std::placeholders::_2));
+    if (maxAcceptsPerEvent_ > 0)
+    {
+        acceptor->setMaxAcceptsPerEvent(maxAcceptsPerEvent_);
     }
+    acceptor->setFdExhaustedCallback(std::bind(&TcpServer::shedConnection,
+        this, kFdExhausted, std::placeholders::_1));
+    acceptor->setBacklog(listenBacklog_);
+    acceptor->setDeferAccept(deferAcceptSeconds_);
+    acceptor->setFastOpen(fastOpenQueueLength_);
+    loopAcceptors_.emplace_back(acceptor);
+    // 组内socket的下标按listen的顺序分配 各个loop异步listen时顺序不确定
+    ioLoop->runInLoopAndWait(std::bind(&Acceptor::listen, acceptor));
+}
+
+void TcpServer::addThread()
+{
+    loop_->runInLoop(std::bind(&TcpServer::addThreadInLoop, this));
+}
+
+void TcpServer::retireThread(EventLoop *ioLoop)
+{
+    loop_->runInLoop(std::bind(&TcpServer::retireThreadInLoop, this, ioLoop));
+}
+
+void TcpServer::addThreadInLoop()
+{
+    EventLoop *ioLoop = threadPool_->addLoop();
+    addShard(ioLoop);
+    if (option_ == kReusePortPerLoop)
+    {
+        startLoopAcceptor(ioLoop);
+        updateCpuSteering();
+    }
+}
+
+void TcpServer::retireThreadInLoop(EventLoop *ioLoop)
+{
+    if (ioLoop == nullptr)
+    {
+        std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+        ioLoop = loops.back();
+    }
+    if (ioLoop == loop_)
+    {
+        LOG_ERROR("TcpServer::retireThread [%s] - no sub loop to retire\n", name_.c_str());
+        return;
+    }
+    // 先关闭这个loop上的监听socket 它的accept队列中还没有accept的连接会被内核重置
+    // 继承来的socket比loop多时 一个loop上可能有多个Acceptor 按删除的顺序关闭 和内核调整组内下标的顺序一致
+    std::vector<Acceptor*> removed;
+    for (size_t i = 0; i < loopAcceptors_.size(); )
+    {
+        if (loopAcceptors_[i]->getLoop() == ioLoop)
+        {
+            removed.push_back(loopAcceptors_[i].release());
+            loopAcceptors_[i].swap(loopAcceptors_.back());
+            loopAcceptors_.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+    if (!removed.empty())
+    {
+        // 等socket真正关闭 组内的下标变了之后再重新设置BPF程序
+        ioLoop->runInLoopAndWait([&removed]() {
+            for (Acceptor *acceptor : removed)
+            {
+                delete acceptor;
+            }
+        });
+        updateCpuSteering();
+    }
+    threadPool_->retireLoop(ioLoop);
 }
 
 //  acceptor 有新连接的时候调用newConnection, acceptor 
-void TcpServer::newConncetion(int sockfd, const InetAddress &peerAddr)
-{
-    // 使用轮询算法， 选择一个subloop 来管理channel
-    EventLoop *ioLoop = threadPool_->getNextLoop();
-    char buf[64] = {0};
-    snprintf(buf, sizeof buf, "-%s#%d", ipPort_.c_str(), nextConnId_); 
-    ++nextConnId_; 
-    std::string connName = name_ + buf;
-    LOG_INFO("TcpServer::newConnection [%s] - new conncetion [%s] from %s \n",
-            name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
-    
-    // 通过sockfd 获取其绑定的本机的ip地址和端口号 
-    sockaddr_in local;
-    ::bzero(&local, sizeof local);
-    socklen_t addrlen = sizeof local;
-    if (::getsockname(sockfd, (sockaddr*)&local, &addrlen) < 0)
+void TcpServer::newConncetion(const std::vector<Acceptor::AcceptedConnection> &batch)
+{
+    // 每个subloop分到的连接 连接风暴时一次唤醒处理一批
+    std::vector<std::pair<EventLoop*, std::vector<TcpConnectionPtr>>> groups;
+    for (const Acceptor::AcceptedConnection &accepted : batch)
+    {
+        if (!admitConnection(accepted.sockfd, accepted.peerAddr))
+        {
+            continue;
+        }
+        // 使用轮询算法， 选择一个subloop 来管理channel
+        EventLoop *ioLoop = cpuSteering_ ? threadPool_->getLoopForCpu(accepted.incomingCpu)
+                                         : threadPool_->getNextLoop();
+        TcpConnectionPtr conn = createConnection(ioLoop, accepted.sockfd, accepted.peerAddr);
+        auto it = groups.begin();
+        while (it != groups.end() && it->first != ioLoop)
+        {
+            ++it;
+        }
+        if (it == groups.end())
+        {
+            groups.emplace_back(ioLoop, std::vector<TcpConnectionPtr>());
+            it = groups.end() - 1;
+        }
+        it->second.push_back(conn);
+    }
+
+    for (auto &group : groups)
     {
-        LOG_ERROR("sockets::getLocalAddr");
+        std::vector<TcpConnectionPtr> conns;
+        conns.swap(group.second);
+        // 直接调用TcpConnection::connectEstablished -> onConnection(用户设置的)
+        EventLoop *ioLoop = group.first;
+        ioLoop->runInLoop([this, ioLoop, conns]() {
+            for (const TcpConnectionPtr &conn : conns)
+            {
+                registerConnection(ioLoop, conn);
+                conn->connectEstablished();
+            }
+        });
     }
-    InetAddress localAddr(local);
+}
+
+void TcpServer::establishConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
+{
+    if (!admitConnection(sockfd, peerAddr))
+    {
+        return;
+    }
+    TcpConnectionPtr conn = createConnection(ioLoop, sockfd, peerAddr);
+    registerConnection(ioLoop, conn);
+    conn->connectEstablished();
+}
+
+TcpConnectionPtr TcpServer::createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr)
+{
+    uint64_t connId = nextConnId_.fetch_add(1, std::memory_order_relaxed);
+    LOG_DEBUG("TcpServer::newConnection [%s] - new conncetion #%lu from %s \n",
+            name_.c_str(), static_cast<unsigned long>(connId), peerAddr.toIpPort().c_str());
     
+    // 通过sockfd 获取其绑定的本机的ip地址和端口号 
+    InetAddress localAddr(InetAddress::getLocalAddr(sockfd));
     
-    // 根据连接成功的sockfd 创建TcpConnection连接对象
-    TcpConnectionPtr conn(new TcpConnection(ioLoop, connName, sockfd, localAddr, peerAddr));
     
-    conncetions_[connName] = conn;
+    // 根据连接成功的sockfd 创建TcpConnection连接对象
+    // TcpConnection(包括Socket Channel)和控制块一次分配 内存来自ioLoop的内存池
+    TcpConnectionPtr conn = std::allocate_shared<TcpConnection>(
+        PoolAllocator<TcpConnection>(ioLoop->connectionPool()),
+        ioLoop, connId, connNamePrefix_, sockfd, localAddr, peerAddr);
      
     // 下面的回调函数都是 用户设置给Tcpserver -> tcpConnection -> Channel -> poller ->  channel 进行回调
     //  用户自己设置的回调函数
     conn->setConnectionCallback(connectionCallback_);
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
+    conn->setReadBudget(readBudgetBytes_, readBudgetMicros_);
+    conn->setSocketOptions(socketOptions_);
     
 
     // 设置如何关闭回调  用户调用shutdown
@@ -106,29 +615,119 @@ void TcpServer::newConncetion(int sockfd, const InetAddress &peerAddr)
     conn->setCloseCallback(
         std::bind(&TcpServer::removeConnection, this, std::placeholders::_1)
     );
-    
-    // 直接调用TcpConnection::connectEstablished -> onConnection(用户设置的)
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    conn->setMigrateCallback(std::bind(&TcpServer::moveConnection, this,
+        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    return conn;
 }
 
-void TcpServer::removeConnection(const TcpConnectionPtr &conn)
+void TcpServer::addShard(EventLoop *ioLoop)
 {
-    loop_->runInLoop(
-        std::bind(&TcpServer::removeConnectionInLoop, this, conn)
-    );
+    ConnectionShard *shard = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::unique_ptr<ConnectionShard> &slot = shards_[ioLoop];
+        if (slot)
+        {
+            return;
+        }
+        slot.reset(new ConnectionShard);
+        shard = slot.get();
+    }
+    // 排在这个loop上所有registerConnection的前面
+    ioLoop->runInLoop([ioLoop, this, shard]() { ioLoop->setLoopLocal(this, shard); });
+}
+
+void TcpServer::removeShard(EventLoop *ioLoop)
+{
+    std::unique_ptr<ConnectionShard> shard;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = shards_.find(ioLoop);
+        if (it == shards_.end())
+        {
+            return;
+        }
+        shard = std::move(it->second);
+        shards_.erase(it);
+    }
+    // loop线程已经退出 没有人再使用这个分片
+    if (!shard->connections.empty())
+    {
+        LOG_ERROR("TcpServer [%s] - reaped loop %p still has %lu connections\n",
+            name_.c_str(), ioLoop, static_cast<unsigned long>(shard->connections.size()));
+    }
 }
 
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
+TcpServer::ConnectionShard* TcpServer::shardOf(const TcpServer *server, EventLoop *ioLoop)
 {
-    LOG_INFO("TcpServer::removeConnectionInLoop[%s] - connection %s\n",
+    return static_cast<ConnectionShard*>(ioLoop->loopLocal(server));
+}
+
+void TcpServer::registerConnection(EventLoop *ioLoop, const TcpConnectionPtr &conn)
+{
+    registerMovedConnection(this, ioLoop, conn);
+}
+
+void TcpServer::registerMovedConnection(const TcpServer *server, EventLoop *ioLoop, const TcpConnectionPtr &conn)
+{
+    ConnectionShard *shard = shardOf(server, ioLoop);
+    if (shard == nullptr)
+    {
+        // TcpServer已经析构 迁移中的连接没有被析构函数找到
+        conn->detachOwner();
+        ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestoryed, conn));
+        return;
+    }
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    shard->connections[conn->id()] = conn;
+}
+
+void TcpServer::moveConnection(const TcpConnectionPtr &conn, EventLoop *from, EventLoop *to)
+{
+    ConnectionShard *shard = shardOf(from);
+    if (shard != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->connections.erase(conn->id());
+    }
+    // 这时连接的loop_还没有改成to 登记时不能用conn->getLoop()
+    // 排在migrateEstablished前面 连接恢复读写(之后才可能关闭)之前已经登记到to的分片
+    // to在migrateTo时已经被计数 不会在这之前回收
+    to->queueInLoop(std::bind(&TcpServer::registerMovedConnection, this, to, conn));
+}
+
+std::vector<TcpConnectionPtr> TcpServer::allConnections()
+{
+    std::vector<TcpConnectionPtr> conns;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &shard : shards_)
+    {
+        std::lock_guard<std::mutex> shardLock(shard.second->mutex);
+        for (auto &item : shard.second->connections)
+        {
+            conns.push_back(item.second);
+        }
+    }
+    return conns;
+}
+
+void TcpServer::removeConnection(const TcpConnectionPtr &conn)
+{
+    LOG_DEBUG("TcpServer::removeConnection [%s] - connection %s\n",
             name_.c_str(), conn->name().c_str());
-            
-    conncetions_.erase(conn->name());
-    
+
     //获取当前loop 
     EventLoop *ioLoop = conn->getLoop();
+    numConnections_.fetch_sub(1, std::memory_order_relaxed);
+    ConnectionShard *shard = shardOf(ioLoop);
+    if (shard != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->connections.erase(conn->id());
+    }
+    
     // 这里再次绕到了tcpConnection::connectDestoryed 方法 中执行channel -》remove
     ioLoop->queueInLoop(
         std::bind(&TcpConnection::connectDestoryed, conn)
     );
-}
\ No newline at end of file
+}
@@ -7,27 +7,51 @@
 #include "EventLoopThreadPool.h" 
 #include "Callbacks.h"
 #include "TcpConnection.h"
+#include "SocketOptions.h"
+#include "TokenBucket.h"
 #include "Buffer.h"
 
 #include <functional>
 #include <memory>
 #include <atomic>
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 class TcpServer : noncopyable
 {
 public:
     // 启动一个loop线程
     using ThreadInitCallback = std::function<void(EventLoop*)>;
+    // 过载时拒绝的连接 在accept所在的loop线程中调用
+    enum ShedReason
+    {
+        kTooManyConnections,    // 超过setMaxConnections
+        kRateLimited,           // 超过setAcceptRate
+        kFdExhausted,           // 进程的fd用完 (EMFILE/ENFILE)
+    };
+    using ShedCallback = std::function<void(ShedReason reason, const InetAddress &peerAddr)>;
     enum Option
     {
         kNoReusePort,
         kReusePort, 
+        // 每个subloop各自创建SO_REUSEPORT的监听socket和Acceptor， 由内核分发新连接
+        // accept、创建TcpConnection都在subloop线程中完成 连接不会跨线程传递
+        kReusePortPerLoop,
     };
+    // listenAddr可以是Unix域地址(InetAddress::fromUnixPath) 这时option总是按kNoReusePort处理
     TcpServer(EventLoop *loop, 
             const InetAddress &listenAddr,
             const std::string &nameArg,
             Option option = kNoReusePort);
+    // 使用已经bind好的监听socket 不再自己创建 见ListenSocketHandoff
+    // kReusePortPerLoop: 按顺序分给各个subloop 不够时其余的loop新建socket加入同一个SO_REUSEPORT组
+    //                    多出来的也依次分给各个loop 不关闭 以免丢掉它们accept队列里的连接
+    // 其他模式: 只使用第一个 其余的关闭
+    TcpServer(EventLoop *loop,
+            const std::vector<int> &listenFds,
+            const std::string &nameArg,
+            Option option = kNoReusePort);
     ~TcpServer();
     
     void setThreadInitcallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
@@ -35,35 +59,145 @@ public:
     void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
     void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb;}
     void setThreadNum(int numThreads);
+    // loop线程的绑核策略 在start之前调用
+    void setThreadPlacement(EventLoopThreadPool::Placement placement,
+                            const std::vector<int> &cpus = std::vector<int>());
+    // 新连接分配到哪个subloop 默认轮询
+    void setLoopSelection(EventLoopThreadPool::Selection selection);
+    void setLoopSelector(const EventLoopThreadPool::LoopSelector &selector);
+    // start之后增减subloop 可以在任意线程中调用 实际操作在baseLoop中执行
+    // retireThread: 该loop不再接收新连接， 已有的连接关闭之后线程退出 loop为空时退役最后加入的那个
+    void addThread();
+    void retireThread(EventLoop *loop = nullptr);
+    // 在start之前调用 每个subloop预先分配expectedChannels个连接需要的空间 之后再开始accept
+    void setPrewarm(int expectedChannels);
+    // 把最热的连接从负载高的loop迁移到负载低的loop 可以在任意线程中调用 实际在baseLoop中执行
+    // 负载是上次rebalance以来每个loop上所有连接收发的字节数， 最高的loop超过平均值的imbalance倍时才迁移
+    // 每次最多迁移maxMoves个连接； 退役中的loop上的连接总是迁移走
+    void rebalance(double imbalance = 1.25, int maxMoves = 4);
+    // 按接收数据包的CPU选择subloop 在start之前调用 需要配合setThreadPlacement把subloop绑定到单个CPU上
+    // kReusePortPerLoop: 给SO_REUSEPORT组设置BPF程序 在SYN所在CPU对应的loop上accept
+    //   继承来的监听socket组内顺序由原来的进程决定 这时不设置
+    // 其他模式: accept之后读取SO_INCOMING_CPU 交给绑定在该CPU上的subloop  找不到时按原来的策略选择
+    void setCpuSteering(bool on);
+    // 每次可读事件最多accept的连接数 在start之前调用
+    void setMaxAcceptsPerEvent(int n);
+    // 监听socket的选项 在start之前调用 见Acceptor::setBacklog/setDeferAccept/setFastOpen
+    // deferAccept适合客户端连接后先发送请求的协议 服务端先发送欢迎信息的协议不能使用
+    void setListenBacklog(int backlog);
+    void setDeferAccept(int seconds);
+    void setFastOpen(int queueLength);
+    // 准入控制 在start之前调用  超出限制的连接accept之后直接关闭 并调用shedCallback
+    // maxConnections 为0表示不限制； rate 每秒最多接受的连接数 burst 允许的突发数 rate为0表示不限制
+    void setMaxConnections(int maxConnections) { maxConnections_ = maxConnections; }
+    void setAcceptRate(double rate, double burst);
+    void setShedCallback(const ShedCallback &cb) { shedCallback_ = cb; }
+    int numConnections() const { return numConnections_.load(std::memory_order_relaxed); }
+    // 新连接的socket选项 默认SocketOptions::defaults() 在start之前调用
+    void setSocketOptions(const SocketOptions &options) { socketOptions_ = options; }
+    // 新连接的读预算 见TcpConnection::setReadBudget
+    void setReadBudget(size_t bytes, int64_t micros) { readBudgetBytes_ = bytes; readBudgetMicros_ = micros; }
+    // 交接给新进程的监听socket 在baseLoop线程中、start之后调用
+    std::vector<int> listenFds() const;
+    // 停止accept 监听socket保持打开 可以在任意线程中调用
+    // 交接之后调用 已有的连接继续服务 等numConnections()降为0再退出
+    void stopAccepting();
     
     void start(); 
 private:
+    TcpServer(EventLoop *loop,
+            const InetAddress &listenAddr,
+            const std::string &nameArg,
+            Option option,
+            const std::vector<int> &listenFds);
 
     // 这个 就是经过accept 之后 建立连接之后 connfd 打包channel 之后 建立连接
     // 非常重要的 回调函数
-    void newConncetion(int sockfd, const InetAddress &peerAddr);
+    // 一次可读事件accept到的所有连接 按subloop分组 每个subloop只投递一次
+    void newConncetion(const std::vector<Acceptor::AcceptedConnection> &batch);
+    // 在ioLoop上创建TcpConnection kReusePortPerLoop时在ioLoop线程中直接调用
+    void establishConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
+    TcpConnectionPtr createConnection(EventLoop *ioLoop, int sockfd, const InetAddress &peerAddr);
+    // kReusePortPerLoop 在ioLoop上创建监听socket并开始accept 等listen完成才返回
+    // 这样组内socket的顺序就是loopAcceptors_的顺序
+    void startLoopAcceptor(EventLoop *ioLoop);
+    // kReusePortPerLoop 按loopAcceptors_的顺序重新设置BPF分发程序
+    void updateCpuSteering();
+    // 在accept所在的loop线程中调用 不接受时关闭sockfd并返回false
+    bool admitConnection(int sockfd, const InetAddress &peerAddr);
+    void shedConnection(ShedReason reason, const InetAddress &peerAddr);
+    void addThreadInLoop();
+    void retireThreadInLoop(EventLoop *ioLoop);
+    void rebalanceInLoop(double imbalance, int maxMoves);
+    // 连接关闭时在连接所在的loop线程中调用 不经过baseLoop
     void removeConnection(const TcpConnectionPtr &conn);
-    void removeConnectionInLoop(const TcpConnectionPtr &conn);
-    using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+    using ConnectionMap = std::unordered_map<uint64_t, TcpConnectionPtr>;
+
+    // 每个loop一个分片 连接只在自己的loop线程中登记和删除
+    // 分片的锁只有allConnections和析构时才会有竞争
+    struct ConnectionShard
+    {
+        std::mutex mutex;
+        ConnectionMap connections;
+    };
+    // loop创建或者加入时在baseLoop中调用 分片指针保存在loop上
+    void addShard(EventLoop *ioLoop);
+    // loop退役回收之后在baseLoop中调用
+    void removeShard(EventLoop *ioLoop);
+    // 只能在ioLoop线程中调用 不加锁  TcpServer析构之后返回nullptr
+    ConnectionShard* shardOf(EventLoop *ioLoop) const { return shardOf(this, ioLoop); }
+    static ConnectionShard* shardOf(const TcpServer *server, EventLoop *ioLoop);
+    // 在ioLoop线程中 connectEstablished之前调用
+    void registerConnection(EventLoop *ioLoop, const TcpConnectionPtr &conn);
+    // 连接迁移时在原来的loop线程中调用
+    void moveConnection(const TcpConnectionPtr &conn, EventLoop *from, EventLoop *to);
+    // moveConnection投递到to 执行时TcpServer可能已经析构 只用server的地址查找分片 找不到时销毁连接
+    static void registerMovedConnection(const TcpServer *server, EventLoop *ioLoop, const TcpConnectionPtr &conn);
+    std::vector<TcpConnectionPtr> allConnections();
 
     
     // baseLoop;
     EventLoop *loop_; 
     const std::string ipPort_;
     const std::string name_;
-    // 运行在mainLoop
+    const InetAddress listenAddr_;
+    const Option option_;
+    // 运行在mainLoop kReusePortPerLoop时为空
     std::unique_ptr<Acceptor> acceptor_;
     // one loop per thread;  
     std::shared_ptr<EventLoopThreadPool> threadPool_;
+    // kReusePortPerLoop 每个loop一个Acceptor 在析构函数中到各自的loop线程里销毁
+    std::vector<std::unique_ptr<Acceptor>> loopAcceptors_;
+    // kReusePortPerLoop 还没有分给loop的继承来的监听socket
+    std::vector<int> inheritedFds_;
+    // kReusePortPerLoop 监听socket是继承来的 组内的顺序不知道 不设置BPF分发程序
+    bool inheritedGroup_;
 
     ConnectionCallback connectionCallback_; // 有新连接时的回调
     MessageCallback messageCallback_; // 有读写消息时的回调
     WriteCompleteCallback writeCompleteCallback_; // 消息发 送完成以后的回调
     
     ThreadInitCallback threadInitCallback_; // loop线程初始化的回调
+    ShedCallback shedCallback_;
+    int maxAcceptsPerEvent_;                // 0 表示使用Acceptor的默认值
+    int listenBacklog_;
+    int deferAcceptSeconds_;
+    int fastOpenQueueLength_;
+    SocketOptions socketOptions_;
+    size_t readBudgetBytes_;
+    int64_t readBudgetMicros_;
+    bool cpuSteering_;
     std::atomic_int started_; 
     
-    int nextConnId_;            
-    ConnectionMap conncetions_; //保存 所有的连接 
+    int maxConnections_;
+    std::atomic_int numConnections_;        // 已经接受 还没有removeConnection的连接数
+    std::unique_ptr<TokenBucket> acceptRate_;
+    std::atomic<uint64_t> nextConnId_;            
+    // 连接名字的前缀 "name-ip:port#"  连接名字在用到的时候才拼上ID
+    const std::shared_ptr<const std::string> connNamePrefix_;
+    std::mutex mutex_;          // 保护shards_ 只有分片的增删和遍历时使用
+    std::unordered_map<EventLoop*, std::unique_ptr<ConnectionShard>> shards_; //保存 所有的连接 
+    // rebalance 在baseLoop中使用 上次rebalance时每个连接收发的字节数
+    std::unordered_map<uint64_t, uint64_t> rebalanceBytes_;
 }; 
 
@@ -1,8 +1,6 @@
 #include "Thread.h"
 #include "CurrentThread.h"
 
-#include <semaphore.h>
-
 std::atomic_int Thread::numCreated_(0);
 
 
@@ -30,19 +28,26 @@ Thread::~Thread()
 void Thread::start() 
 {
     started_ = true;
-    sem_t sem;
-    sem_init(&sem, false, 0);
     // thread_ = std::shared_ptr<std::thread>)(new std::thread(出入lambda表达 ))
-    // [&]() ->void{ }
-    // &访问外部对象任意的成员变量
-    thread_ = std::shared_ptr<std::thread>(new std::thread([&](){
-        tid_ = CurrentThread::tid();
-        // 保证获取获取线程ID
-        sem_post(&sem);
+    // 不在这里等待新线程记录tid 多个线程可以同时启动， tid()需要时再等待
+    thread_ = std::shared_ptr<std::thread>(new std::thread([this](){
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tid_ = CurrentThread::tid();
+        }
+        cond_.notify_all();
         func_(); 
     }));
-    
-    sem_wait(&sem);
+}
+
+pid_t Thread::tid() const
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (started_ && tid_ == 0)
+    {
+        cond_.wait(lock);
+    }
+    return tid_;
 }
 
 void Thread::join()
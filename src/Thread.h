@@ -7,6 +7,8 @@
 #include <unistd.h>
 #include <string>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
 // 
 class Thread : noncopyable
 {
@@ -15,11 +17,13 @@ public:
     explicit Thread(ThreadFunc, const std::string &name = std::string());
     // 如果使用Thread类直接定义对象， 线程就直接启动
     ~Thread(); 
+    // 只创建线程 不等待线程运行起来 多个线程可以并行启动
     void start();
     void join();
 
     bool started() const {return started_;}
-    pid_t tid() const {return tid_;}
+    // 线程还没有运行到记录tid的地方时 阻塞等待
+    pid_t tid() const;
 
     const std::string& name() const {return name_;}
     static int numCreated() {return numCreated_;}
@@ -34,6 +38,8 @@ private:
     //std::thread thread_; 
     std::shared_ptr<std::thread> thread_;
     pid_t tid_;
+    mutable std::mutex mutex_;      // 保护tid_
+    mutable std::condition_variable cond_;
     ThreadFunc  func_; // 存储线程函数 。
     std::string name_;
     static std::atomic_int numCreated_; // 对所有 线程进行计数的
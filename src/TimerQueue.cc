@@ -0,0 +1,137 @@
+#include "TimerQueue.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <sys/timerfd.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+static int createTimerfd()
+{
+    int timerfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerfd < 0)
+    {
+        LOG_FATAL("%s:%s:%d timerfd_create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    return timerfd;
+}
+
+TimerQueue::TimerQueue(EventLoop *loop)
+    : loop_(loop)
+    , timerfd_(createTimerfd())
+    , timerfdChannel_(loop, timerfd_)
+    , nextTimerId_(1)
+{
+    timerfdChannel_.setReadCallback(std::bind(&TimerQueue::handleRead, this));
+    timerfdChannel_.enableReading();
+}
+
+TimerQueue::~TimerQueue()
+{
+    timerfdChannel_.disableAll();
+    timerfdChannel_.remove();
+    ::close(timerfd_);
+}
+
+TimerId TimerQueue::addTimer(TimerCallback cb, Timestamp when, double interval)
+{
+    TimerId timerId = nextTimerId_.fetch_add(1, std::memory_order_relaxed);
+    Timer timer;
+    timer.callback = std::move(cb);
+    timer.expiration = when.microSecondsSinceEpoch();
+    timer.interval = interval > 0 ? static_cast<int64_t>(interval * Timestamp::kMicroSecondsPerSecond) : 0;
+    loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timerId, std::move(timer)));
+    return timerId;
+}
+
+void TimerQueue::cancel(TimerId timerId)
+{
+    loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
+}
+
+void TimerQueue::addTimerInLoop(TimerId timerId, const Timer &timer)
+{
+    bool earliest = entries_.empty() || timer.expiration < entries_.begin()->first;
+    entries_.insert(Entry(timer.expiration, timerId));
+    timers_[timerId] = timer;
+    if (earliest)
+    {
+        resetTimerfd();
+    }
+}
+
+void TimerQueue::cancelInLoop(TimerId timerId)
+{
+    auto it = timers_.find(timerId);
+    if (it == timers_.end())
+    {
+        return;
+    }
+    // 正在执行的定时器已经不在entries_中 从timers_删除之后就不会再重新加入
+    entries_.erase(Entry(it->second.expiration, timerId));
+    timers_.erase(it);
+}
+
+void TimerQueue::handleRead()
+{
+    uint64_t howmany = 0;
+    ::read(timerfd_, &howmany, sizeof howmany);
+
+    int64_t now = Timestamp::now().microSecondsSinceEpoch();
+    expired_.clear();
+    auto end = entries_.lower_bound(Entry(now + 1, 0));
+    expired_.assign(entries_.begin(), end);
+    entries_.erase(entries_.begin(), end);
+
+    for (const Entry &entry : expired_)
+    {
+        auto it = timers_.find(entry.second);
+        if (it == timers_.end())
+        {
+            continue;
+        }
+        // 回调里可能添加定时器导致rehash 先拷贝一份
+        TimerCallback cb = it->second.callback;
+        cb();
+    }
+    for (const Entry &entry : expired_)
+    {
+        auto it = timers_.find(entry.second);
+        if (it == timers_.end())
+        {
+            continue;
+        }
+        if (it->second.interval > 0)
+        {
+            it->second.expiration = now + it->second.interval;
+            entries_.insert(Entry(it->second.expiration, entry.second));
+        }
+        else
+        {
+            timers_.erase(it);
+        }
+    }
+    resetTimerfd();
+}
+
+void TimerQueue::resetTimerfd()
+{
+    itimerspec newValue;
+    ::memset(&newValue, 0, sizeof newValue);
+    if (!entries_.empty())
+    {
+        int64_t micros = entries_.begin()->first - Timestamp::now().microSecondsSinceEpoch();
+        // 已经到期的也要设置一个非0值 0会关闭timerfd
+        if (micros < 100)
+        {
+            micros = 100;
+        }
+        newValue.it_value.tv_sec = static_cast<time_t>(micros / Timestamp::kMicroSecondsPerSecond);
+        newValue.it_value.tv_nsec = static_cast<long>((micros % Timestamp::kMicroSecondsPerSecond) * 1000);
+    }
+    if (::timerfd_settime(timerfd_, 0, &newValue, nullptr) < 0)
+    {
+        LOG_ERROR("timerfd_settime err:%d \n", errno);
+    }
+}
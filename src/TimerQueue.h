@@ -0,0 +1,54 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Channel.h"
+#include "Callbacks.h"
+
+#include <atomic>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class EventLoop;
+
+/*
+定时器队列 每个EventLoop一个  使用timerfd 到期时和其他channel一样由poller报告
+addTimer/cancel可以在任意线程中调用 实际操作在loop线程中执行
+定时器按(到期时间, id)排序 timerfd总是设置为最早的到期时间
+*/
+class TimerQueue : noncopyable
+{
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    // 在when执行cb  interval > 0 时之后每隔interval秒重复执行
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+    // 回调中取消自己也可以 重复的定时器不会再次执行
+    void cancel(TimerId timerId);
+
+private:
+    struct Timer
+    {
+        TimerCallback callback;
+        int64_t expiration;     // 微秒
+        int64_t interval;       // 微秒 0表示只执行一次
+    };
+    using Entry = std::pair<int64_t, TimerId>;
+
+    void addTimerInLoop(TimerId timerId, const Timer &timer);
+    void cancelInLoop(TimerId timerId);
+    void handleRead();
+    // 按最早的到期时间设置timerfd
+    void resetTimerfd();
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+    std::atomic<TimerId> nextTimerId_;
+    std::set<Entry> entries_;
+    std::unordered_map<TimerId, Timer> timers_;
+    std::vector<Entry> expired_;
+};
@@ -1,4 +1,5 @@
 #include "Timestamp.h"
+#include "Clock.h"
 #include <time.h>
 
 
@@ -6,22 +7,25 @@ Timestamp::Timestamp() : microSecondsSinceEpoch_(0) {}
 
 Timestamp::Timestamp(int64_t microSecondsSinceEpoch):microSecondsSinceEpoch_(microSecondsSinceEpoch) {}
 
+// 时钟源由Clock决定 默认gettimeofday
 Timestamp Timestamp::now()
 {
-    return Timestamp(time(NULL));
+    return Timestamp(Clock::nowMicroSeconds());
 } 
 
 std::string Timestamp::toString() const
 {
     char buf[128] = {0}; 
-    tm *tm_time = localtime(&microSecondsSinceEpoch_); 
+    time_t seconds = secondsSinceEpoch();
+    tm tm_time;
+    localtime_r(&seconds, &tm_time); 
     snprintf(buf, 128, "%4d/%02d/%02d  %02d:%02d:%02d", 
-            tm_time->tm_year + 1900,
-            tm_time->tm_mon + 1,
-            tm_time->tm_mday,
-            tm_time->tm_hour,
-            tm_time->tm_min,
-            tm_time->tm_sec);
+            tm_time.tm_year + 1900,
+            tm_time.tm_mon + 1,
+            tm_time.tm_mday,
+            tm_time.tm_hour,
+            tm_time.tm_min,
+            tm_time.tm_sec);
     return buf;
     
 }
@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <string>
+#include <stdint.h>
+#include <time.h>
  
 class Timestamp
 {
@@ -18,6 +20,14 @@ public:
     // 使用常函数的原因
     std::string toString() const; 
 
+    int64_t microSecondsSinceEpoch() const { return microSecondsSinceEpoch_; }
+    time_t secondsSinceEpoch() const
+    {
+        return static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond);
+    }
+
+    static const int kMicroSecondsPerSecond = 1000 * 1000;
+
 private:
     int64_t microSecondsSinceEpoch_;  
 };
\ No newline at end of file
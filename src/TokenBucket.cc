@@ -0,0 +1,30 @@
+#include "TokenBucket.h"
+
+#include <algorithm>
+
+TokenBucket::TokenBucket(double rate, double burst)
+    : rate_(rate)
+    , burst_(std::max(burst, 1.0))
+    , tokens_(burst_)
+    , lastRefill_(0)
+{
+}
+
+bool TokenBucket::tryTake(int64_t nowMicroSeconds)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (lastRefill_ != 0 && nowMicroSeconds > lastRefill_)
+    {
+        tokens_ = std::min(burst_, tokens_ + (nowMicroSeconds - lastRefill_) * rate_ / 1000000.0);
+    }
+    if (nowMicroSeconds > lastRefill_)
+    {
+        lastRefill_ = nowMicroSeconds;
+    }
+    if (tokens_ < 1.0)
+    {
+        return false;
+    }
+    tokens_ -= 1.0;
+    return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "noncopyable.h"
+#include <stdint.h>
+#include <mutex>
+
+/*
+令牌桶 每秒补充rate个令牌 最多积攒burst个
+TcpServer用来限制accept的速率  kReusePortPerLoop时多个loop线程同时使用 所以需要加锁
+*/
+class TokenBucket : noncopyable
+{
+public:
+    TokenBucket(double rate, double burst);
+
+    // 拿到一个令牌返回true  nowMicroSeconds由调用方提供 loop线程中可以使用Clock::cachedNow()
+    bool tryTake(int64_t nowMicroSeconds);
+
+private:
+    std::mutex mutex_;
+    const double rate_;
+    const double burst_;
+    double tokens_;
+    int64_t lastRefill_;
+};
@@ -0,0 +1,244 @@
+#include "UdpChannel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+const int UdpChannel::kDefaultBatchSize;
+const size_t UdpChannel::kDefaultMaxDatagram;
+
+// 每次可读事件最多收取的数据报个数
+const int kDefaultMaxDatagramsPerEvent = 256;
+
+static int createUdpSocket(const InetAddress &bindAddr, bool reuseport)
+{
+    if (bindAddr.family() != AF_INET)
+    {
+        LOG_FATAL("UdpChannel %s - only IPv4 addresses are supported \n", bindAddr.toIpPort().c_str());
+    }
+    int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        LOG_FATAL("%s:%s:%d udp socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+    if (reuseport)
+    {
+        ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof on);
+    }
+    if (::bind(fd, bindAddr.sockAddr(), bindAddr.sockAddrLen()) < 0)
+    {
+        LOG_FATAL("udp bind %s fail err:%d \n", bindAddr.toIpPort().c_str(), errno);
+    }
+    return fd;
+}
+
+UdpChannel::UdpChannel(EventLoop *loop, const InetAddress &bindAddr, bool reuseport,
+                       int batchSize, size_t maxDatagram)
+    : loop_(loop)
+    , fd_(createUdpSocket(bindAddr, reuseport))
+    , channel_(loop, fd_)
+    , batchSize_(batchSize > 0 ? batchSize : 1)
+    , maxDatagram_(maxDatagram)
+    , maxDatagramsPerEvent_(kDefaultMaxDatagramsPerEvent)
+    , recvBuffer_(batchSize_ * maxDatagram_)
+    , recvIovecs_(batchSize_)
+    , recvAddrs_(batchSize_)
+    , recvMsgs_(batchSize_)
+    , sendBuffer_(batchSize_ * maxDatagram_)
+    , sendIovecs_(batchSize_)
+    , sendAddrs_(batchSize_)
+    , sendMsgs_(batchSize_)
+    , sendCount_(0)
+    , inReadHandler_(false)
+    , flushScheduled_(false)
+    , alive_(std::make_shared<bool>(true))
+    , received_(0)
+    , sent_(0)
+    , dropped_(0)
+{
+    ::memset(recvMsgs_.data(), 0, sizeof(mmsghdr) * recvMsgs_.size());
+    ::memset(sendMsgs_.data(), 0, sizeof(mmsghdr) * sendMsgs_.size());
+    for (int i = 0; i < batchSize_; ++i)
+    {
+        recvIovecs_[i].iov_base = &recvBuffer_[i * maxDatagram_];
+        recvIovecs_[i].iov_len = maxDatagram_;
+        recvMsgs_[i].msg_hdr.msg_iov = &recvIovecs_[i];
+        recvMsgs_[i].msg_hdr.msg_iovlen = 1;
+        recvMsgs_[i].msg_hdr.msg_name = &recvAddrs_[i];
+
+        sendIovecs_[i].iov_base = &sendBuffer_[i * maxDatagram_];
+        sendMsgs_[i].msg_hdr.msg_iov = &sendIovecs_[i];
+        sendMsgs_[i].msg_hdr.msg_iovlen = 1;
+        sendMsgs_[i].msg_hdr.msg_name = &sendAddrs_[i];
+        sendMsgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+    }
+    channel_.setReadCallback(std::bind(&UdpChannel::handleRead, this, std::placeholders::_1));
+    channel_.setWriteCallback(std::bind(&UdpChannel::handleWrite, this));
+}
+
+UdpChannel::~UdpChannel()
+{
+    channel_.disableAll();
+    channel_.remove();
+    ::close(fd_);
+}
+
+void UdpChannel::start()
+{
+    channel_.enableReading();
+}
+
+void UdpChannel::handleRead(Timestamp receiveTime)
+{
+    inReadHandler_ = true;
+    int total = 0;
+    while (total < maxDatagramsPerEvent_)
+    {
+        // recvmmsg会改写msg_namelen 每次都要重新设置
+        for (int i = 0; i < batchSize_; ++i)
+        {
+            recvMsgs_[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+        }
+        int vlen = std::min(batchSize_, maxDatagramsPerEvent_ - total);
+        int n = ::recvmmsg(fd_, recvMsgs_.data(), vlen, MSG_DONTWAIT, nullptr);
+        if (n <= 0)
+        {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                LOG_ERROR("UdpChannel::handleRead recvmmsg err:%d \n", errno);
+            }
+            break;
+        }
+        total += n;
+        for (int i = 0; i < n; ++i)
+        {
+            if (recvMsgs_[i].msg_hdr.msg_flags & MSG_TRUNC)
+            {
+                ++dropped_;
+                continue;
+            }
+            ++received_;
+            if (messageCallback_)
+            {
+                messageCallback_(this, static_cast<const char*>(recvIovecs_[i].iov_base),
+                                 recvMsgs_[i].msg_len, InetAddress(recvAddrs_[i]), receiveTime);
+            }
+        }
+        if (n < vlen)
+        {
+            break;
+        }
+    }
+    inReadHandler_ = false;
+    flush();
+}
+
+void UdpChannel::send(const InetAddress &peer, const char *data, size_t len)
+{
+    if (peer.family() != AF_INET)
+    {
+        LOG_ERROR("UdpChannel::send %s - only IPv4 addresses are supported \n", peer.toIpPort().c_str());
+        ++dropped_;
+        return;
+    }
+    if (len > maxDatagram_)
+    {
+        // 超过预分配槽位的数据报直接发送
+        flush();
+        if (::sendto(fd_, data, len, 0, peer.sockAddr(), peer.sockAddrLen()) < 0)
+        {
+            ++dropped_;
+        }
+        else
+        {
+            ++sent_;
+        }
+        return;
+    }
+    if (sendCount_ == batchSize_)
+    {
+        flush();
+        if (sendCount_ == batchSize_)
+        {
+            ++dropped_;
+            return;
+        }
+    }
+    ::memcpy(sendIovecs_[sendCount_].iov_base, data, len);
+    sendIovecs_[sendCount_].iov_len = len;
+    sendAddrs_[sendCount_] = *peer.getSockAddr();
+    ++sendCount_;
+    if (sendCount_ == batchSize_)
+    {
+        flush();
+    }
+    else if (!inReadHandler_)
+    {
+        scheduleFlush();
+    }
+}
+
+void UdpChannel::scheduleFlush()
+{
+    if (!flushScheduled_)
+    {
+        flushScheduled_ = true;
+        std::weak_ptr<bool> alive(alive_);
+        loop_->queueInLoop([this, alive]() {
+            if (alive.expired())
+            {
+                return;
+            }
+            flushScheduled_ = false;
+            flush();
+        });
+    }
+}
+
+void UdpChannel::flush()
+{
+    if (sendCount_ == 0 || channel_.isWriting())
+    {
+        return;
+    }
+    int n = ::sendmmsg(fd_, sendMsgs_.data(), sendCount_, MSG_DONTWAIT);
+    if (n < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+        {
+            channel_.enableWriting();
+            return;
+        }
+        // 其他错误(比如对端不可达)只影响第一个数据报 丢掉它继续发送剩下的
+        LOG_DEBUG("UdpChannel::flush sendmmsg err:%d \n", errno);
+        n = 1;
+        ++dropped_;
+    }
+    else
+    {
+        sent_ += n;
+    }
+    // 没发完的前移 槽位里的地址和iov_base不动 只移动数据和长度
+    for (int i = n; i < sendCount_; ++i)
+    {
+        ::memcpy(sendIovecs_[i - n].iov_base, sendIovecs_[i].iov_base, sendIovecs_[i].iov_len);
+        sendIovecs_[i - n].iov_len = sendIovecs_[i].iov_len;
+        sendAddrs_[i - n] = sendAddrs_[i];
+    }
+    sendCount_ -= n;
+    if (sendCount_ > 0)
+    {
+        channel_.enableWriting();
+    }
+}
+
+void UdpChannel::handleWrite()
+{
+    channel_.disableWriting();
+    flush();
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Channel.h"
+#include "InetAddress.h"
+#include "Timestamp.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class EventLoop;
+
+/*
+一个UDP socket 和它在EventLoop中的Channel  只在所属的loop线程中使用
+接收: 可读时用recvmmsg一次收取batchSize个数据报 放在预先分配的缓冲区里 逐个交给messageCallback
+      每次可读事件最多收maxDatagramsPerEvent个 剩下的留到下一轮 不饿死同一个loop上的其他channel
+发送: send先放进预先分配的发送批次 收包回调结束后或者本轮loop末尾用sendmmsg一次发出
+      内核发送缓冲区满时关注可写事件 等待期间批次满了就丢弃新的数据报 (UDP本身不保证送达)
+超过maxDatagram被截断的数据报直接丢弃 不交给messageCallback
+只支持IPv4地址
+*/
+class UdpChannel : noncopyable
+{
+public:
+    // data只在回调期间有效
+    using MessageCallback = std::function<void(UdpChannel *channel, const char *data, size_t len,
+                                               const InetAddress &peer, Timestamp receiveTime)>;
+
+    static const int kDefaultBatchSize = 64;
+    static const size_t kDefaultMaxDatagram = 2048;
+
+    UdpChannel(EventLoop *loop, const InetAddress &bindAddr, bool reuseport,
+               int batchSize = kDefaultBatchSize, size_t maxDatagram = kDefaultMaxDatagram);
+    ~UdpChannel();
+
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    void setMaxDatagramsPerEvent(int n) { maxDatagramsPerEvent_ = n > 0 ? n : 1; }
+
+    // 在loop线程中调用
+    void start();
+    void send(const InetAddress &peer, const char *data, size_t len);
+    void flush();
+
+    EventLoop* getLoop() const { return loop_; }
+    int fd() const { return fd_; }
+    uint64_t datagramsReceived() const { return received_; }
+    uint64_t datagramsSent() const { return sent_; }
+    // 发送时丢弃的 加上接收时被截断的
+    uint64_t datagramsDropped() const { return dropped_; }
+
+private:
+    void handleRead(Timestamp receiveTime);
+    void handleWrite();
+    // 批次不在收包过程中时 投递一次flush到本轮loop的末尾
+    void scheduleFlush();
+
+    EventLoop *loop_;
+    const int fd_;
+    Channel channel_;
+    const int batchSize_;
+    const size_t maxDatagram_;
+    int maxDatagramsPerEvent_;
+    MessageCallback messageCallback_;
+
+    // 接收批次 第i个数据报在recvBuffer_[i * maxDatagram_]
+    std::vector<char> recvBuffer_;
+    std::vector<iovec> recvIovecs_;
+    std::vector<sockaddr_in> recvAddrs_;
+    std::vector<mmsghdr> recvMsgs_;
+
+    // 发送批次 sendCount_个待发送
+    std::vector<char> sendBuffer_;
+    std::vector<iovec> sendIovecs_;
+    std::vector<sockaddr_in> sendAddrs_;
+    std::vector<mmsghdr> sendMsgs_;
+    int sendCount_;
+    bool inReadHandler_;
+    bool flushScheduled_;
+    // 投递出去的flush只持有weak_ptr channel先析构时不再访问this
+    std::shared_ptr<bool> alive_;
+
+    uint64_t received_;
+    uint64_t sent_;
+    uint64_t dropped_;
+};
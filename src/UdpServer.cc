@@ -0,0 +1,95 @@
+#include "UdpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+static EventLoop* CheckLoopNotNull(EventLoop *loop)
+{
+    if (loop == nullptr)
+    {
+        LOG_FATAL("%s:%s:%d mainLoop is null! \n", __FILE__, __FUNCTION__, __LINE__);
+    }
+    return loop;
+}
+
+UdpServer::UdpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &nameArg,
+                     Option option)
+    : loop_(CheckLoopNotNull(loop))
+    , listenAddr_(listenAddr)
+    , name_(nameArg)
+    , option_(option)
+    , threadPool_(new EventLoopThreadPool(loop, nameArg))
+    , batchSize_(UdpChannel::kDefaultBatchSize)
+    , maxDatagram_(UdpChannel::kDefaultMaxDatagram)
+    , maxDatagramsPerEvent_(0)
+    , started_(false)
+{
+}
+
+UdpServer::~UdpServer()
+{
+    // Channel要在所属loop的线程中从poller删除 等待删除完成之后再继续
+    for (std::unique_ptr<UdpChannel> &channel : channels_)
+    {
+        UdpChannel *raw = channel.release();
+        raw->getLoop()->runInLoopAndWait([raw]() { delete raw; });
+    }
+    channels_.clear();
+}
+
+void UdpServer::setThreadNum(int numThreads)
+{
+    threadPool_->setThreadNum(numThreads);
+}
+
+void UdpServer::start()
+{
+    if (started_)
+    {
+        return;
+    }
+    started_ = true;
+    threadPool_->start(threadInitCallback_);
+    if (option_ == kSingleSocket)
+    {
+        startChannel(loop_, false);
+        return;
+    }
+    // 没有subloop时getAllLoops返回baseLoop
+    // 所有socket都在这里bind 之后才开始收包 组内成员固定 内核的哈希分发不会变化
+    for (EventLoop *ioLoop : threadPool_->getAllLoops())
+    {
+        startChannel(ioLoop, true);
+    }
+}
+
+void UdpServer::startChannel(EventLoop *ioLoop, bool reuseport)
+{
+    UdpChannel *channel = new UdpChannel(ioLoop, listenAddr_, reuseport, batchSize_, maxDatagram_);
+    channel->setMessageCallback(messageCallback_);
+    if (maxDatagramsPerEvent_ > 0)
+    {
+        channel->setMaxDatagramsPerEvent(maxDatagramsPerEvent_);
+    }
+    channels_.emplace_back(channel);
+    ioLoop->runInLoop(std::bind(&UdpChannel::start, channel));
+}
+
+uint64_t UdpServer::datagramsReceived() const
+{
+    uint64_t total = 0;
+    for (const std::unique_ptr<UdpChannel> &channel : channels_)
+    {
+        total += channel->datagramsReceived();
+    }
+    return total;
+}
+
+uint64_t UdpServer::datagramsSent() const
+{
+    uint64_t total = 0;
+    for (const std::unique_ptr<UdpChannel> &channel : channels_)
+    {
+        total += channel->datagramsSent();
+    }
+    return total;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "EventLoopThreadPool.h"
+#include "InetAddress.h"
+#include "UdpChannel.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class EventLoop;
+
+/*
+UDP服务 每个UdpChannel只属于一个loop 回调在该loop线程中执行， 回复直接调用channel->send
+*/
+class UdpServer : noncopyable
+{
+public:
+    using ThreadInitCallback = std::function<void(EventLoop*)>;
+    using MessageCallback = UdpChannel::MessageCallback;
+    enum Option
+    {
+        kSingleSocket,          // 只有一个socket 在baseLoop中收发
+        kReusePortPerLoop,      // 每个subloop各自一个SO_REUSEPORT的socket 由内核按四元组哈希分发
+    };
+
+    UdpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &nameArg,
+              Option option = kReusePortPerLoop);
+    ~UdpServer();
+
+    void setThreadInitcallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    // 以下在start之前调用
+    void setThreadNum(int numThreads);
+    // 每次recvmmsg/sendmmsg的数据报个数 和单个数据报的最大长度
+    void setBatchSize(int batchSize) { batchSize_ = batchSize; }
+    void setMaxDatagram(size_t maxDatagram) { maxDatagram_ = maxDatagram; }
+    // 每次可读事件最多处理的数据报个数 0表示使用UdpChannel的默认值
+    void setMaxDatagramsPerEvent(int n) { maxDatagramsPerEvent_ = n; }
+
+    void start();
+
+    const std::string& name() const { return name_; }
+    // 所有socket收到和发出的数据报总数 只是统计用 不保证和其他线程同步
+    uint64_t datagramsReceived() const;
+    uint64_t datagramsSent() const;
+
+private:
+    void startChannel(EventLoop *ioLoop, bool reuseport);
+
+    EventLoop *loop_;
+    const InetAddress listenAddr_;
+    const std::string name_;
+    const Option option_;
+    std::unique_ptr<EventLoopThreadPool> threadPool_;
+    ThreadInitCallback threadInitCallback_;
+    MessageCallback messageCallback_;
+    int batchSize_;
+    size_t maxDatagram_;
+    int maxDatagramsPerEvent_;
+    bool started_;
+    std::vector<std::unique_ptr<UdpChannel>> channels_;
+};
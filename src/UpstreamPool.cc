@@ -0,0 +1,277 @@
+#include "UpstreamPool.h"
+#include "Buffer.h"
+#include "Clock.h"
+#include "EventLoop.h"
+#include "Logger.h"
+#include "TcpClient.h"
+#include "TcpConnection.h"
+
+#include <algorithm>
+
+// 每个线程最多一个UpstreamPool 和t_loopInThisThread一样
+__thread UpstreamPool *t_poolInThisThread = nullptr;
+
+const int kDefaultMaxConnections = 4;
+const int kDefaultMaxPipeline = 16;
+const int kDefaultMaxQueue = 1024;
+const int kDefaultQueueTimeoutMs = 1000;
+
+UpstreamPool::UpstreamPool(EventLoop *loop, const std::string &name, const Framer &framer)
+    : loop_(loop)
+    , name_(name)
+    , framer_(framer)
+    , maxConnections_(kDefaultMaxConnections)
+    , maxPipeline_(kDefaultMaxPipeline)
+    , maxQueue_(kDefaultMaxQueue)
+    , queueTimeoutMs_(kDefaultQueueTimeoutMs)
+{
+    if (!loop_->isInLoopThread())
+    {
+        LOG_FATAL("UpstreamPool [%s] must be created in its loop thread\n", name_.c_str());
+    }
+    t_poolInThisThread = this;
+}
+
+UpstreamPool::~UpstreamPool()
+{
+    // TcpClient析构时会关闭连接 关闭的回调里不能再访问UpstreamPool
+    for (auto &item : upstreams_)
+    {
+        if (item.second->expireTimer != 0)
+        {
+            loop_->cancel(item.second->expireTimer);
+        }
+        for (std::unique_ptr<PooledConnection> &pooled : item.second->connections)
+        {
+            if (pooled->conn)
+            {
+                pooled->conn->setConnectionCallback([](const TcpConnectionPtr &) {});
+                pooled->conn->setMessageCallback([](const TcpConnectionPtr &, Buffer *buf, Timestamp) { buf->retrieveAll(); });
+            }
+        }
+    }
+    if (t_poolInThisThread == this)
+    {
+        t_poolInThisThread = nullptr;
+    }
+}
+
+UpstreamPool* UpstreamPool::forCurrentThread()
+{
+    return t_poolInThisThread;
+}
+
+UpstreamPool::Upstream* UpstreamPool::upstreamOf(const InetAddress &addr)
+{
+    std::unique_ptr<Upstream> &upstream = upstreams_[addr.toIpPort()];
+    if (!upstream)
+    {
+        upstream.reset(new Upstream{addr, {}, {}, 0});
+    }
+    return upstream.get();
+}
+
+UpstreamPool::PooledConnection* UpstreamPool::newConnection(Upstream *upstream)
+{
+    PooledConnection *pooled = new PooledConnection;
+    upstream->connections.emplace_back(pooled);
+    pooled->client.reset(new TcpClient(loop_, upstream->addr, name_));
+    pooled->client->setSocketOptions(socketOptions_);
+    pooled->client->setConnectionCallback([this, upstream, pooled](const TcpConnectionPtr &conn) {
+        onConnection(upstream, pooled, conn);
+    });
+    pooled->client->setConnectFailedCallback(std::bind(&UpstreamPool::onConnectFailed, this, upstream));
+    pooled->client->setMessageCallback([this, upstream, pooled](const TcpConnectionPtr &, Buffer *buf, Timestamp) {
+        onMessage(upstream, pooled, buf);
+    });
+    pooled->client->connect();
+    return pooled;
+}
+
+UpstreamPool::PooledConnection* UpstreamPool::pickConnection(Upstream *upstream)
+{
+    PooledConnection *best = nullptr;
+    for (const std::unique_ptr<PooledConnection> &pooled : upstream->connections)
+    {
+        if (pooled->conn && static_cast<int>(pooled->inflight.size()) < maxPipeline_
+            && (best == nullptr || pooled->inflight.size() < best->inflight.size()))
+        {
+            best = pooled.get();
+        }
+    }
+    return best;
+}
+
+void UpstreamPool::call(const InetAddress &addr, const std::string &request, ResponseCallback cb)
+{
+    Upstream *upstream = upstreamOf(addr);
+    PooledConnection *pooled = upstream->waiting.empty() ? pickConnection(upstream) : nullptr;
+    if (pooled != nullptr)
+    {
+        send(pooled, Request{request, std::move(cb), 0});
+        return;
+    }
+    if (static_cast<int>(upstream->waiting.size()) >= maxQueue_)
+    {
+        LOG_DEBUG("UpstreamPool [%s] - queue to %s is full\n", name_.c_str(), addr.toIpPort().c_str());
+        cb(false, std::string());
+        return;
+    }
+    int64_t deadline = Clock::nowMicroSeconds() + queueTimeoutMs_ * 1000LL;
+    upstream->waiting.push_back(Request{request, std::move(cb), deadline});
+    armExpireTimer(upstream);
+    // 正在建立的连接也算在内 它们建立之后会处理排队的请求
+    if (static_cast<int>(upstream->connections.size()) < maxConnections_)
+    {
+        newConnection(upstream);
+    }
+}
+
+void UpstreamPool::prewarm(const InetAddress &addr, int connections)
+{
+    Upstream *upstream = upstreamOf(addr);
+    int target = std::min(connections, maxConnections_);
+    while (static_cast<int>(upstream->connections.size()) < target)
+    {
+        newConnection(upstream);
+    }
+}
+
+int UpstreamPool::numConnections() const
+{
+    int n = 0;
+    for (const auto &item : upstreams_)
+    {
+        n += static_cast<int>(item.second->connections.size());
+    }
+    return n;
+}
+
+void UpstreamPool::send(PooledConnection *pooled, Request &&request)
+{
+    pooled->inflight.push_back(std::move(request.callback));
+    pooled->conn->send(request.data);
+}
+
+void UpstreamPool::dispatchWaiting(Upstream *upstream)
+{
+    while (!upstream->waiting.empty())
+    {
+        PooledConnection *pooled = pickConnection(upstream);
+        if (pooled == nullptr)
+        {
+            break;
+        }
+        Request request = std::move(upstream->waiting.front());
+        upstream->waiting.pop_front();
+        send(pooled, std::move(request));
+    }
+}
+
+void UpstreamPool::failWaiting(Upstream *upstream, bool all)
+{
+    // 回调中可能再次调用call 先把失败的请求取出来
+    std::deque<Request> failed;
+    int64_t now = Clock::nowMicroSeconds();
+    while (!upstream->waiting.empty() && (all || upstream->waiting.front().deadline <= now))
+    {
+        failed.push_back(std::move(upstream->waiting.front()));
+        upstream->waiting.pop_front();
+    }
+    if (!failed.empty())
+    {
+        LOG_DEBUG("UpstreamPool [%s] - %zu queued requests to %s failed\n",
+                  name_.c_str(), failed.size(), upstream->addr.toIpPort().c_str());
+    }
+    for (Request &request : failed)
+    {
+        request.callback(false, std::string());
+    }
+}
+
+void UpstreamPool::armExpireTimer(Upstream *upstream)
+{
+    if (upstream->expireTimer != 0 || upstream->waiting.empty())
+    {
+        return;
+    }
+    int64_t delay = upstream->waiting.front().deadline - Clock::nowMicroSeconds();
+    upstream->expireTimer = loop_->runAfter(std::max<int64_t>(delay, 0) / 1000000.0,
+                                            std::bind(&UpstreamPool::onExpireTimer, this, upstream));
+}
+
+void UpstreamPool::onExpireTimer(Upstream *upstream)
+{
+    upstream->expireTimer = 0;
+    failWaiting(upstream, false);
+    armExpireTimer(upstream);
+}
+
+void UpstreamPool::onConnectFailed(Upstream *upstream)
+{
+    LOG_DEBUG("UpstreamPool [%s] - connect to %s failed\n", name_.c_str(), upstream->addr.toIpPort().c_str());
+    // 其他连接可用时排队的请求由它们处理
+    for (const std::unique_ptr<PooledConnection> &other : upstream->connections)
+    {
+        if (other->conn)
+        {
+            return;
+        }
+    }
+    failWaiting(upstream, true);
+}
+
+void UpstreamPool::onConnection(Upstream *upstream, PooledConnection *pooled, const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        pooled->conn = conn;
+        dispatchWaiting(upstream);
+        return;
+    }
+
+    LOG_DEBUG("UpstreamPool [%s] - connection to %s closed with %zu requests in flight\n",
+              name_.c_str(), upstream->addr.toIpPort().c_str(), pooled->inflight.size());
+    std::deque<ResponseCallback> failed;
+    failed.swap(pooled->inflight);
+    pooled->conn.reset();
+
+    // 正在TcpClient的回调中 TcpClient延后到回调返回之后再删除
+    auto it = std::find_if(upstream->connections.begin(), upstream->connections.end(),
+        [pooled](const std::unique_ptr<PooledConnection> &p) { return p.get() == pooled; });
+    if (it != upstream->connections.end())
+    {
+        std::shared_ptr<PooledConnection> dead(it->release());
+        upstream->connections.erase(it);
+        loop_->queueInLoop([dead]() {});
+    }
+
+    for (ResponseCallback &cb : failed)
+    {
+        cb(false, std::string());
+    }
+    // 还有排队的请求 补一条连接
+    if (!upstream->waiting.empty() && static_cast<int>(upstream->connections.size()) < maxConnections_)
+    {
+        newConnection(upstream);
+    }
+}
+
+void UpstreamPool::onMessage(Upstream *upstream, PooledConnection *pooled, Buffer *buf)
+{
+    size_t len = 0;
+    while (buf->readableBytes() > 0 && (len = framer_(buf)) > 0)
+    {
+        std::string response = buf->retrieveAsString(len);
+        if (pooled->inflight.empty())
+        {
+            LOG_ERROR("UpstreamPool [%s] - unexpected response from %s\n",
+                      name_.c_str(), upstream->addr.toIpPort().c_str());
+            continue;
+        }
+        ResponseCallback cb = std::move(pooled->inflight.front());
+        pooled->inflight.pop_front();
+        cb(true, response);
+    }
+    dispatchWaiting(upstream);
+}
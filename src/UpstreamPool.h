@@ -0,0 +1,113 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "InetAddress.h"
+#include "SocketOptions.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Buffer;
+class EventLoop;
+class TcpClient;
+
+/*
+到后端服务的连接池 每个EventLoop一个 只在所属的loop线程中使用 请求和响应都不跨线程
+每个后端地址最多maxConnections条连接， 连接建立之后一直保持 给后续的请求复用
+每条连接上最多同时有maxPipeline个请求在等待响应 (pipelining) 响应按请求的顺序返回
+连接都满了的请求排队 有连接空出来时再发送
+排队超过queueTimeout 或者队列已经有maxQueue个请求时 回调ok为false
+后端连不上时Connector按退避时间一直重试 每次连接失败时如果没有可用的连接 排队的请求全部失败
+析构时在途和排队的请求直接丢弃 不调用回调
+
+协议由framer决定: framer 返回buffer开头一个完整响应的长度 不完整时返回0
+
+    // 每个io线程一个 比如在ThreadInitCallback中创建
+    new UpstreamPool(loop, "backend", framer);
+    ...
+    UpstreamPool::forCurrentThread()->call(addr, request, [](bool ok, const std::string &response) {...});
+*/
+class UpstreamPool : noncopyable
+{
+public:
+    using Framer = std::function<size_t(const Buffer *buf)>;
+    // ok为false表示没有得到响应: 请求发出之后连接断开 排队超时 队列已满 或者连不上后端
+    using ResponseCallback = std::function<void(bool ok, const std::string &response)>;
+
+    UpstreamPool(EventLoop *loop, const std::string &name, const Framer &framer);
+    ~UpstreamPool();
+
+    // 当前线程中创建的UpstreamPool 没有时返回nullptr
+    static UpstreamPool* forCurrentThread();
+
+    // 在call之前设置
+    void setMaxConnections(int n) { maxConnections_ = n > 0 ? n : 1; }
+    void setMaxPipeline(int n) { maxPipeline_ = n > 0 ? n : 1; }
+    void setSocketOptions(const SocketOptions &options) { socketOptions_ = options; }
+    // 每个后端地址最多排队的请求数 默认1024
+    void setMaxQueue(int n) { maxQueue_ = n > 0 ? n : 1; }
+    // 请求最多排队多久 默认1000ms
+    void setQueueTimeout(int milliseconds) { queueTimeoutMs_ = milliseconds > 0 ? milliseconds : 1; }
+
+    // 以下在loop线程中调用
+    void call(const InetAddress &addr, const std::string &request, ResponseCallback cb);
+    // 预先建立到addr的连接 最多maxConnections条
+    void prewarm(const InetAddress &addr, int connections);
+    int numConnections() const;
+
+    EventLoop* getLoop() const { return loop_; }
+
+private:
+    struct Request
+    {
+        std::string data;
+        ResponseCallback callback;
+        int64_t deadline;                   // 排队的截止时间 Clock::nowMicroSeconds
+    };
+    struct Upstream;
+    // 一条到后端的连接 inflight是已经发出 等待响应的请求
+    struct PooledConnection
+    {
+        std::unique_ptr<TcpClient> client;
+        TcpConnectionPtr conn;              // 连接建立之前为空
+        std::deque<ResponseCallback> inflight;
+    };
+    struct Upstream
+    {
+        InetAddress addr;
+        std::vector<std::unique_ptr<PooledConnection>> connections;
+        std::deque<Request> waiting;        // 按入队时间排列 截止时间也是递增的
+        TimerId expireTimer;                // 队首请求的超时定时器 0表示没有
+    };
+
+    Upstream* upstreamOf(const InetAddress &addr);
+    PooledConnection* newConnection(Upstream *upstream);
+    // 可用的连接中在途请求最少的 没有时返回nullptr
+    PooledConnection* pickConnection(Upstream *upstream);
+    void send(PooledConnection *pooled, Request &&request);
+    // 把排队的请求发送到有空位的连接上
+    void dispatchWaiting(Upstream *upstream);
+    // 让排队的请求失败 all为false时只处理已经超时的
+    void failWaiting(Upstream *upstream, bool all);
+    void armExpireTimer(Upstream *upstream);
+    void onExpireTimer(Upstream *upstream);
+    void onConnectFailed(Upstream *upstream);
+
+    void onConnection(Upstream *upstream, PooledConnection *pooled, const TcpConnectionPtr &conn);
+    void onMessage(Upstream *upstream, PooledConnection *pooled, Buffer *buf);
+
+    EventLoop *loop_;
+    const std::string name_;
+    Framer framer_;
+    int maxConnections_;
+    int maxPipeline_;
+    int maxQueue_;
+    int queueTimeoutMs_;
+    SocketOptions socketOptions_;
+    std::unordered_map<std::string, std::unique_ptr<Upstream>> upstreams_;
+};
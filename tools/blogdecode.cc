@@ -0,0 +1,349 @@
+#include <mymuduo/BinaryLogging.h>
+#include <mymuduo/Logger.h>
+#include <mymuduo/Timestamp.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+把BinaryLogging写出的二进制日志还原为文本， 格式和Logger输出一致
+    [INFO] 2023/01/01  12:00:00.123456:msg
+
+用法: ./blogdecode binary.log [-t]       -t 在每行前面输出线程tid
+*/
+
+namespace
+{
+
+struct Format
+{
+    int level;
+    std::string file;
+    int line;
+    std::string fmt;
+};
+
+struct Arg
+{
+    uint8_t type;
+    int64_t i;
+    uint64_t u;
+    double d;
+    std::string s;
+};
+
+const char* levelName(int level)
+{
+    switch (level)
+    {
+    case INFO:
+        return "[INFO] ";
+    case ERROR:
+        return "[ERROR] ";
+    case FATAL:
+        return "[FATAL] ";
+    case DEBUG:
+        return "[DEBUG] ";
+    default:
+        return "";
+    }
+}
+
+template <typename T>
+bool readValue(FILE *fp, T *v)
+{
+    return ::fread(v, sizeof *v, 1, fp) == 1;
+}
+
+bool readString16(FILE *fp, std::string *s)
+{
+    uint16_t len = 0;
+    if (!readValue(fp, &len))
+    {
+        return false;
+    }
+    s->resize(len);
+    return len == 0 || ::fread(&(*s)[0], 1, len, fp) == len;
+}
+
+// 解析一条记录中的参数
+bool parseArgs(const char *p, const char *end, std::vector<Arg> *args)
+{
+    while (p < end)
+    {
+        Arg arg;
+        arg.type = static_cast<uint8_t>(*p++);
+        arg.i = 0;
+        arg.u = 0;
+        arg.d = 0;
+        switch (arg.type)
+        {
+        case BinaryLogging::kInt64:
+            if (end - p < 8) return false;
+            memcpy(&arg.i, p, 8);
+            arg.u = static_cast<uint64_t>(arg.i);
+            arg.d = static_cast<double>(arg.i);
+            p += 8;
+            break;
+        case BinaryLogging::kUInt64:
+        case BinaryLogging::kPointer:
+            if (end - p < 8) return false;
+            memcpy(&arg.u, p, 8);
+            arg.i = static_cast<int64_t>(arg.u);
+            arg.d = static_cast<double>(arg.u);
+            p += 8;
+            break;
+        case BinaryLogging::kDouble:
+            if (end - p < 8) return false;
+            memcpy(&arg.d, p, 8);
+            arg.i = static_cast<int64_t>(arg.d);
+            arg.u = static_cast<uint64_t>(arg.d);
+            p += 8;
+            break;
+        case BinaryLogging::kString:
+        {
+            if (end - p < 1) return false;
+            uint8_t len = static_cast<uint8_t>(*p++);
+            if (end - p < len) return false;
+            arg.s.assign(p, len);
+            p += len;
+            break;
+        }
+        default:
+            return false;
+        }
+        args->push_back(arg);
+    }
+    return true;
+}
+
+/*
+按照printf的规则遍历格式串， 每个转换说明单独交给snprintf处理
+长度修饰符统一换成 ll， 因为记录的整数都是64位的
+*/
+std::string render(const std::string &fmt, const std::vector<Arg> &args)
+{
+    std::string out;
+    size_t next = 0;
+    char buf[512];
+    for (size_t i = 0; i < fmt.size(); ++i)
+    {
+        if (fmt[i] != '%')
+        {
+            out += fmt[i];
+            continue;
+        }
+        if (i + 1 < fmt.size() && fmt[i + 1] == '%')
+        {
+            out += '%';
+            ++i;
+            continue;
+        }
+
+        std::string spec = "%";
+        size_t j = i + 1;
+        while (j < fmt.size() && strchr("-+ #0", fmt[j]))
+        {
+            spec += fmt[j++];
+        }
+        // 宽度和精度可能是 * 由参数给出
+        for (int part = 0; part < 2; ++part)
+        {
+            if (part == 1)
+            {
+                if (j >= fmt.size() || fmt[j] != '.')
+                {
+                    break;
+                }
+                spec += fmt[j++];
+            }
+            if (j < fmt.size() && fmt[j] == '*')
+            {
+                int v = next < args.size() ? static_cast<int>(args[next++].i) : 0;
+                spec += std::to_string(v);
+                ++j;
+            }
+            while (j < fmt.size() && fmt[j] >= '0' && fmt[j] <= '9')
+            {
+                spec += fmt[j++];
+            }
+        }
+        while (j < fmt.size() && strchr("hlLqjzt", fmt[j]))
+        {
+            ++j;
+        }
+        if (j >= fmt.size())
+        {
+            out += fmt.substr(i);
+            break;
+        }
+
+        char conv = fmt[j];
+        const Arg *arg = next < args.size() ? &args[next++] : nullptr;
+        if (arg == nullptr)
+        {
+            out += "<missing>";
+        }
+        else if (strchr("di", conv))
+        {
+            snprintf(buf, sizeof buf, (spec + "ll" + conv).c_str(), static_cast<long long>(arg->i));
+            out += buf;
+        }
+        else if (strchr("uoxX", conv))
+        {
+            snprintf(buf, sizeof buf, (spec + "ll" + conv).c_str(), static_cast<unsigned long long>(arg->u));
+            out += buf;
+        }
+        else if (strchr("fFeEgGaA", conv))
+        {
+            snprintf(buf, sizeof buf, (spec + conv).c_str(), arg->d);
+            out += buf;
+        }
+        else if (conv == 'c')
+        {
+            snprintf(buf, sizeof buf, (spec + conv).c_str(), static_cast<int>(arg->i));
+            out += buf;
+        }
+        else if (conv == 's')
+        {
+            snprintf(buf, sizeof buf, (spec + conv).c_str(), arg->s.c_str());
+            out += buf;
+        }
+        else if (conv == 'p')
+        {
+            snprintf(buf, sizeof buf, (spec + conv).c_str(), reinterpret_cast<void*>(arg->u));
+            out += buf;
+        }
+        else
+        {
+            out += fmt.substr(i, j - i + 1);
+        }
+        i = j;
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s binary.log [-t]\n", argv[0]);
+        return 1;
+    }
+    bool showTid = argc > 2 && strcmp(argv[2], "-t") == 0;
+
+    FILE *fp = ::fopen(argv[1], "rb");
+    if (fp == nullptr)
+    {
+        perror("fopen");
+        return 1;
+    }
+    char magic[sizeof BinaryLogging::kFileMagic];
+    if (::fread(magic, sizeof magic, 1, fp) != 1
+        || memcmp(magic, BinaryLogging::kFileMagic, sizeof magic) != 0)
+    {
+        fprintf(stderr, "%s is not a binary log file\n", argv[1]);
+        return 1;
+    }
+
+    std::unordered_map<uint32_t, Format> formats;
+    std::vector<char> chunk;
+    std::vector<Arg> args;
+    char timebuf[64];
+    uint8_t type = 0;
+    while (readValue(fp, &type))
+    {
+        if (type == BinaryLogging::kFormatChunk)
+        {
+            uint32_t id = 0;
+            uint8_t level = 0;
+            uint32_t line = 0;
+            Format format;
+            if (!readValue(fp, &id) || !readValue(fp, &level) || !readValue(fp, &line)
+                || !readString16(fp, &format.file) || !readString16(fp, &format.fmt))
+            {
+                break;
+            }
+            format.level = level;
+            format.line = static_cast<int>(line);
+            formats[id] = format;
+        }
+        else if (type == BinaryLogging::kRecordChunk)
+        {
+            uint32_t bytes = 0;
+            if (!readValue(fp, &bytes))
+            {
+                break;
+            }
+            chunk.resize(bytes);
+            if (bytes > 0 && ::fread(&chunk[0], 1, bytes, fp) != bytes)
+            {
+                break;
+            }
+            const char *p = chunk.data();
+            const char *end = p + bytes;
+            while (static_cast<size_t>(end - p) >= BinaryLogging::kRecordHeaderSize)
+            {
+                uint32_t length = 0;
+                uint32_t formatId = 0;
+                int64_t micros = 0;
+                int32_t tid = 0;
+                memcpy(&length, p, 4);
+                memcpy(&formatId, p + 4, 4);
+                memcpy(&micros, p + 8, 8);
+                memcpy(&tid, p + 16, 4);
+                if (length < BinaryLogging::kRecordHeaderSize || length > static_cast<size_t>(end - p))
+                {
+                    fprintf(stderr, "corrupted record\n");
+                    break;
+                }
+
+                args.clear();
+                auto it = formats.find(formatId);
+                if (it == formats.end() || !parseArgs(p + BinaryLogging::kRecordHeaderSize, p + length, &args))
+                {
+                    fprintf(stderr, "unknown format id %u\n", formatId);
+                }
+                else
+                {
+                    int n = Logger::formatTime(Timestamp(micros), timebuf);
+                    timebuf[n] = '\0';
+                    std::string msg = render(it->second.fmt, args);
+                    if (msg.empty() || msg[msg.size() - 1] != '\n')
+                    {
+                        msg += '\n';
+                    }
+                    if (showTid)
+                    {
+                        printf("%d ", tid);
+                    }
+                    printf("%s%s:%s", levelName(it->second.level), timebuf, msg.c_str());
+                }
+                p += length;
+            }
+        }
+        else if (type == BinaryLogging::kDroppedChunk)
+        {
+            int32_t tid = 0;
+            uint64_t count = 0;
+            if (!readValue(fp, &tid) || !readValue(fp, &count))
+            {
+                break;
+            }
+            fprintf(stderr, "thread %d dropped %llu records\n", tid, static_cast<unsigned long long>(count));
+        }
+        else
+        {
+            fprintf(stderr, "unknown chunk type %d\n", type);
+            break;
+        }
+    }
+    ::fclose(fp);
+    return 0;
+}